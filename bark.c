@@ -1,8 +1,19 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /* Exit status codes */
 #define ERROR_BAD_ARGS 1
@@ -12,12 +23,19 @@
 #define ERROR_SHORT_DECK 5
 #define ERROR_FULL_BOARD 6
 #define ERROR_END_HUMAN_INPUT 7
+#define ERROR_FEED_READ 8
+#define ERROR_ARCHIVE_WRITE 9
 
 /* Status Reads */
 #define NEW_GAME 1
 #define END_GAME 0
 #define MIDDLE_GAME 2
 
+/* Input Reads */
+#define INPUT_INVALID 0
+#define INPUT_MOVE 1
+#define INPUT_REWIND 2
+
 /* Buffers */
 #define CHAR_BUFFER 30
 
@@ -29,6 +47,58 @@
 #define TURN_ONE 1
 #define TURN_TWO 2
 
+/* AI player types */
+#define AI_BASIC 'a'
+#define AI_PONDER 'p'
+#define AI_ENDGAME 'e'
+#define HUMAN 'h'
+
+/* History Constants */
+#define HISTORY_START 64
+
+/* Spectator Feed Constants */
+#define FEED_ENV "BARK_FEED"
+#define FEED_MAGIC 0x4B524142 // "BARK"
+#define FEED_VERSION 2
+#define FEED_EVENTS 256
+#define FEED_MOVE 0
+#define FEED_REWIND 1
+#define FEED_POLL_NS 10000000
+
+/* Archive Constants */
+#define ARCHIVE_MAGIC "BARKARC1"
+#define ARCHIVE_KEY_SIZE 48
+#define ARCHIVE_SEPARATOR ':'
+
+/* Endgame Solver Constants */
+#define SOLVE_EMPTY_CELLS 6
+#define SOLVE_CARDS_LEFT 2
+#define SOLVE_NODE_LIMIT 1000000
+#define SOLVE_TABLE_BITS 18
+#define SOLVE_INFINITY 1000000
+#define SOLVE_FULL_DEPTH INT_MAX
+#define BOUND_EXACT 0
+#define BOUND_LOWER 1
+#define BOUND_UPPER 2
+
+/* Ponder Constants */
+#define PONDER_NODE_LIMIT 200000 // For each deeper search of a reply
+#define PONDER_CHECK_NODES 1024 // How often a search checks for a stop
+
+/* Opening Book Constants */
+#define BOOK_ENV "BARK_BOOK"
+#define BOOK_MAGIC "BARKBOOK"
+
+/* Tournament Constants */
+#define ELO_START 1500.0
+#define ELO_K 16.0
+#define TOURNAMENT_MAX_THREADS 256
+
+/* Path Constants */
+#define NUM_SUITS 26
+#define PATH_MAX_LENGTH 9 // Numbers strictly increase along a path
+#define NUM_DIRECTIONS 4
+
 /* Macros to read cards in a for loop */
 #define GET_NUM(x) (2 * x)
 #define GET_SUIT(x) (2 * x + 1)
@@ -54,6 +124,265 @@ typedef struct {
 } CardArray;
 
 
+/* A move as the hand slot played and the cell it was played to.
+ *
+ * @param card - position of the card in hand (0 - 5)
+ * @param row - board row
+ * @param col - board column
+ */
+typedef struct {
+    int card;
+    int row;
+    int col;
+} Move;
+
+/* Everything needed to take back one turn, including its deal.
+ *
+ * @param turn - Whose turn it was, either 1 or 2
+ * @param status - The status before the turn
+ * @param cardsDrawn - cardsDrawn before the deal
+ * @param handLength - Each hand's length before the deal
+ * @param move - The move made
+ * @param card - The card played
+ */
+typedef struct {
+    int turn;
+    int status;
+    int cardsDrawn;
+    int handLength[NUM_PLAYERS];
+    Move move;
+    Card card;
+} TurnRecord;
+
+/* The turns played so far, plus turns taken back that can be redone.
+ *
+ * @param records - One record per turn
+ * @param size - The number of turns played
+ * @param count - The number of turns that can be redone up to
+ * @param capacity - Space allocated for records
+ * @param pending - The turn in progress, recorded before its deal
+ */
+typedef struct {
+    TurnRecord* records;
+    int size;
+    int count;
+    int capacity;
+    TurnRecord pending;
+} History;
+
+/* The longest paths from each cell, kept between scores. Every path
+ * from a valid cell leads only through valid cells, so a cell can only
+ * become invalid along with every cell that leads to it.
+ *
+ * @param best - Per cell and suit, the most cards in a path from the cell
+ *      to a card of that suit, or 0 if there is none
+ * @param next - Per cell and suit, the next cell in that path, or -1 if
+ *      it ends at the cell
+ * @param valid - Per cell, whether best and next are up to date
+ */
+typedef struct {
+    int* best;
+    int* next;
+    bool* valid;
+} PathCache;
+
+/* One entry in the spectator feed's event ring.
+ *
+ * @param kind - FEED_MOVE, or FEED_REWIND for an UNDO or REDO
+ * @param turn - The player who moved, either 1 or 2
+ * @param card - The card played
+ * @param row - board row
+ * @param col - board column
+ */
+typedef struct {
+    int kind;
+    int turn;
+    Card card;
+    int row;
+    int col;
+} FeedEvent;
+
+/* A game published to shared memory for spectators. The writer makes
+ * seq odd while it updates, so readers retry until they see the same
+ * even seq before and after copying.
+ *
+ * @param magic - FEED_MAGIC
+ * @param version - FEED_VERSION
+ * @param seq - The seqlock sequence number
+ * @param finished - Whether the game is over
+ * @param exitCode - What the game exited with, once finished
+ * @param width - board width
+ * @param height - board height
+ * @param turn - Players turn, either 1 or 2
+ * @param status - NewGame, EndGame, MiddleGame
+ * @param cardsDrawn - number of cards pulled from the deck
+ * @param deckLength - number of cards in the deck
+ * @param handLength - The length of each hand
+ * @param hands - Each players hand
+ * @param numEvents - The number of events ever published
+ * @param events - The latest FEED_EVENTS events, by numEvents modulo
+ * @param board - The board, row by row
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;
+    int finished;
+    int exitCode;
+    int width;
+    int height;
+    int turn;
+    int status;
+    int cardsDrawn;
+    int deckLength;
+    int handLength[NUM_PLAYERS];
+    Card hands[NUM_PLAYERS][HAND_SIZE];
+    uint64_t numEvents;
+    FeedEvent events[FEED_EVENTS];
+    Card board[];
+} Feed;
+
+/* The start of an archive file. Saves follow it back to back, then the
+ * index.
+ *
+ * @param magic - ARCHIVE_MAGIC
+ * @param indexOffset - Where the index starts
+ * @param count - The number of index entries
+ */
+typedef struct {
+    char magic[8];
+    uint64_t indexOffset;
+    uint64_t count;
+} ArchiveHeader;
+
+/* An archive index entry. Entries are sorted by key.
+ *
+ * @param key - The saves key, such as game id and turn ("g42/17")
+ * @param offset - Where the save text starts
+ * @param length - The length of the save text
+ */
+typedef struct {
+    char key[ARCHIVE_KEY_SIZE];
+    uint64_t offset;
+    uint64_t length;
+} ArchiveEntry;
+
+/* Reads the saves of an archive one after another, in key order.
+ *
+ * @param index - The archive, positioned at the next index entry
+ * @param saves - The archive, for reading save text
+ * @param header - The archive's header
+ * @param next - The number of saves read so far
+ */
+typedef struct {
+    FILE* index;
+    FILE* saves;
+    ArchiveHeader header;
+    uint64_t next;
+} ArchiveReader;
+
+/* A searched position in the endgame solver's table.
+ *
+ * @param key - The position hash, 0 if unused
+ * @param value - Player 1's final score less Player 2's
+ * @param bound - BOUND_EXACT, or whether value is a lower or upper bound
+ * @param depth - The number of moves searched ahead
+ */
+typedef struct {
+    uint64_t key;
+    int value;
+    int bound;
+    int depth;
+} SolveEntry;
+
+/* The start of an opening book file, followed by its entries.
+ *
+ * @param magic - BOOK_MAGIC
+ * @param count - The number of entries
+ */
+typedef struct {
+    char magic[8];
+    uint64_t count;
+} BookHeader;
+
+/* A book move. Entries are sorted by key.
+ *
+ * @param key - The position's hash, see position_key
+ * @param num - The number of the card to play
+ * @param suit - The suit of the card to play
+ * @param row - board row
+ * @param col - board column
+ * @param value - Player 1's score less Player 2's after the search
+ */
+typedef struct {
+    uint64_t key;
+    char num;
+    char suit;
+    unsigned char row;
+    unsigned char col;
+    int32_t value;
+} BookEntry;
+
+/* An opening book mapped into memory.
+ *
+ * @param map - The mapping
+ * @param size - The size of the mapping
+ * @param entries - The entries, within the mapping
+ * @param count - The number of entries
+ */
+typedef struct {
+    void* map;
+    size_t size;
+    BookEntry* entries;
+    uint64_t count;
+} Book;
+
+/* A book entry while generating a book.
+ *
+ * @param entry - The entry
+ * @param order - When it was found, so the first one for a position wins
+ */
+typedef struct {
+    BookEntry entry;
+    uint64_t order;
+} BuildEntry;
+
+/* Book entries collected while generating a book.
+ *
+ * @param entries - The entries so far
+ * @param count - The number of entries
+ * @param capacity - Space allocated for entries
+ * @param depth - The deepest search for each position
+ */
+typedef struct {
+    BuildEntry* entries;
+    uint64_t count;
+    uint64_t capacity;
+    int depth;
+} BookBuilder;
+
+/* State for one exact endgame search.
+ *
+ * @param table - Solved positions, indexed by the low bits of their hash
+ * @param boardHash - Hash of the cards on the board, kept incrementally
+ * @param empty - The number of empty cells
+ * @param nodes - Positions searched so far
+ * @param limit - The most positions to search
+ * @param ponder - Pondering search to stop with (or NULL)
+ * @param aborted - Whether the limit was reached or pondering stopped
+ */
+typedef struct {
+    SolveEntry* table;
+    uint64_t boardHash;
+    int empty;
+    long nodes;
+    long limit;
+    struct Ponder* ponder;
+    bool aborted;
+} Solver;
+
+struct Ponder;
+
 /* The location of all necessary game variables
  *
  * @param width - board width
@@ -65,6 +394,12 @@ typedef struct {
  * @param cardsDrawn - number of cards pulled from the deck
  * @param deck - An array to store the deck in
  * @param hands - An array to store the players hands in.
+ * @param lastMove - The most recent move made
+ * @param history - Turns that can be undone and redone
+ * @param feed - Shared memory for spectators (or NULL)
+ * @param paths - Cached longest paths (or NULL until first scored)
+ * @param book - Opening book for AI players (or NULL)
+ * @param ponder - Background search run during human turns (or NULL)
  */
 typedef struct {
     int width;
@@ -77,14 +412,135 @@ typedef struct {
     int cardsDrawn;
     CardArray deck;
     CardArray hands[NUM_PLAYERS];
+    Move lastMove;
+    History history;
+    Feed* feed;
+    PathCache* paths;
+    Book* book;
+    struct Ponder* ponder;
 } Game;
 
+/* The answer to one possible human reply, found while pondering.
+ *
+ * @param ready - Whether the search for this reply has finished
+ * @param endsGame - Whether the reply ends the game before the AI moves
+ * @param answer - The AI's move after the reply
+ * @param depth - Moves searched ahead for the answer
+ */
+typedef struct {
+    bool ready;
+    bool endsGame;
+    Move answer;
+    int depth;
+} PonderEntry;
+
+/* A human reply ranked by how good it looks to the human.
+ *
+ * @param move - The reply
+ * @param value - The human's score less the AI's after the reply
+ * @param order - Position in enumeration order, to break ties
+ */
+typedef struct {
+    Move move;
+    int value;
+    int order;
+} RankedReply;
+
+/* A way of choosing AI moves.
+ *
+ * @param type - The player type given on the command line
+ * @param name - A name to report results under
+ * @param choose - Pick a move for the current player without making it,
+ *      returning false if there is none
+ */
+typedef struct {
+    char type;
+    const char* name;
+    bool (*choose)(Game* game, Move* move);
+} Strategy;
+
+/* One tournament game, filled in by whichever worker plays it.
+ *
+ * @param seed - Seed for the deck
+ * @param players - Index into strategies of each player
+ * @param scores - Final score of each player
+ */
+typedef struct {
+    uint64_t seed;
+    int players[NUM_PLAYERS];
+    int scores[NUM_PLAYERS];
+} Match;
+
+/* A worker's deque of match indices. The owner takes from the bottom,
+ * other workers steal from the top.
+ *
+ * @param lock - Guards top and bottom
+ * @param tasks - Match indices
+ * @param top - Index of the oldest task
+ * @param bottom - One past the newest task
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    int* tasks;
+    int top;
+    int bottom;
+} WorkQueue;
+
+/* A round-robin tournament between every pair of strategies.
+ *
+ * @param width - board width
+ * @param height - board height
+ * @param matches - Every game to play
+ * @param numMatches - The number of games
+ * @param queues - One work queue per worker
+ * @param numWorkers - The number of worker threads
+ * @param book - Opening book for the players (or NULL)
+ */
+typedef struct {
+    int width;
+    int height;
+    Book* book;
+    Match* matches;
+    int numMatches;
+    WorkQueue* queues;
+    int numWorkers;
+} Tournament;
+
+/* A worker thread's view of the tournament.
+ *
+ * @param tournament - The tournament being played
+ * @param id - Index of the worker's own queue
+ */
+typedef struct {
+    Tournament* tournament;
+    int id;
+} Worker;
+
+/* Background search over the human's replies.
+ *
+ * @param thread - The pondering thread
+ * @param lock - Guards stop
+ * @param stop - Set when the human has moved and pondering must end
+ * @param position - A private copy of the game with the human to move
+ * @param cardsDrawn - cardsDrawn once the AI has been dealt its card
+ * @param entries - One entry per (hand slot, row, column) reply
+ */
+typedef struct Ponder {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    bool stop;
+    Game position;
+    int cardsDrawn;
+    PonderEntry* entries;
+} Ponder;
+
 /* File + Argument parsing function */
 char* read_line(FILE* f, char** line);
 int read_int(char* line);
 char check_player(char* line);
 int check_dimension(char* line);
 void parse_save_file(Game* game, char* fileName);
+void parse_save_stream(Game* game, FILE* f);
 void parse_deck_file(Game* game);
 void parse_line_one(char* line, Game* game); 
 void parse_hands(Game* game, char* line, int player);
@@ -95,39 +551,215 @@ bool check_card(char suit, char num);
 /* Game Running functions */
 void exit_game(int exitCode);
 void game_loop(Game* game);
-void player_handler(Game* game);
+bool player_handler(Game* game);
 void calc_scores(Game* game);
+void score_board(Game* game, int* scores);
 
 /* Game Helper functions*/
 void save_game(Game* game, char* fileName);
+void write_save(Game* game, FILE* f);
 void make_move(Game* game, int x, int y, int c);
-void return_move(Game* game);
+void unmake_move(Game* game, Move move, Card card, int status);
+bool return_move(Game* game, Move* move);
 void get_path_length(Game* game, int row, int col, int length, 
         int* longest, char charToCheck);
 bool adjacent_to(Game*, int x, int y);
+bool legal_move(Game* game, int row, int col);
 bool board_full(Game* game);
-bool check_input(Game* game, char* line);
+int check_input(Game* game, char* line);
 bool check_entry(Game* game, char* line);
 bool get_neighbour(Game* game, Card c, int row, int col,
         int** coords, int* size);
+void copy_game(Game* dest, Game* src);
+void free_game(Game* game);
+
+/* Path functions */
+PathCache* path_cache(Game* game);
+void path_cell(Game* game, PathCache* cache, int row, int col);
+void path_invalidate(Game* game, int row, int col);
+void path_forget(Game* game, int row, int col, Card c);
+bool neighbour_cell(Game* game, int row, int col, int direction,
+        int* nRow, int* nCol);
+int longest_path(Game* game, int player, char suit, int* cells);
+int find_path(Game* game, int player, char suit, int* cells, int* found);
+void print_path(Game* game, int length, int* cells);
+void print_paths(Game* game);
+
+/* AI functions */
+void ai_move(Game* game);
+const Strategy* find_strategy(char type);
+bool choose_greedy(Game* game, Move* move);
+bool search_greedy(Game* game, Move* best, Ponder* ponder);
+int evaluate_move(Game* game, Move move);
+void ponder_start(Game* game);
+void ponder_stop(Game* game);
+void* ponder_run(void* arg);
+bool ponder_reply(Game* position, Move reply);
+void ponder_store(Ponder* ponder, Game* base, Move reply, PonderEntry entry);
+bool ponder_stopped(Ponder* ponder);
+bool ponder_lookup(Game* game, Move* move);
+void ponder_free(Ponder* ponder);
+void ponder_discard(Game* game);
+bool duplicate_card(CardArray* hand, int c);
+int compare_replies(const void* a, const void* b);
+
+/* Endgame Solver functions */
+bool endgame_near(Game* game);
+bool choose_endgame(Game* game, Move* move);
+bool solve_root(Game* game, Move* best, int* value, long* nodes, int depth,
+        long limit, Ponder* ponder);
+int solve_node(Solver* solver, Game* game, int alpha, int beta, int depth);
+void solve_play(Solver* solver, Game* game, Move move);
+void solve_unplay(Solver* solver, Game* game, Move move, Card card,
+        int status);
+uint64_t solve_key(Solver* solver, Game* game);
+uint64_t card_hash(uint64_t where, Card card);
+uint64_t hand_key(Game* game);
+void analyse(Game* game);
+
+/* Opening Book functions */
+Book* book_open(char* path);
+bool book_move(Game* game, Move* move);
+uint64_t position_key(Game* game);
+int compare_book(const void* a, const void* b);
+int compare_build(const void* a, const void* b);
+void build_book(char* path, int width, int height, int plies, int depth,
+        int numDecks, char** decks);
+void book_explore(BookBuilder* builder, Game* game, int plies);
+
+/* History functions */
+bool history_deal(Game* game);
+void record_deal(Game* game, TurnRecord* record);
+void history_move(Game* game);
+void undo_deal(Game* game, TurnRecord* record);
+bool undo_turns(Game* game);
+bool redo_turns(Game* game);
+
+/* Spectator Feed functions */
+void feed_open(Game* game, char* name);
+void feed_begin(Feed* feed);
+void feed_end(Feed* feed);
+void feed_publish(Game* game, bool finished);
+void feed_event(Game* game, int kind);
+void feed_close(int exitCode);
+void spectate(char* name);
+size_t feed_size(int width, int height);
+
+/* Archive functions */
+bool split_archive_name(char* name, char** path, char** key);
+bool archive_read_header(FILE* f, ArchiveHeader* header);
+bool archive_find(FILE* f, ArchiveHeader* header, char* key,
+        ArchiveEntry* entry);
+char* archive_load(char* path, char* key, size_t* length);
+bool archive_compact(char* path, FILE* f, ArchiveEntry* index,
+        uint64_t count);
+bool archive_append(char* path, int n, char** keys, char** texts,
+        size_t* lengths);
+int compare_entries(const void* a, const void* b);
+void archive_pack(char* path, int n, char** args);
+void archive_list(char* path);
+bool archive_open(ArchiveReader* reader, char* path);
+bool archive_next(ArchiveReader* reader, ArchiveEntry* entry, Game* game);
+void archive_close(ArchiveReader* reader);
 
 /* Output Functions */
 void print_board(Game* game);
 void print_deck(Game* game);
 
+/* Tournament functions */
+void run_tournament(int width, int height, int seeds, int threads,
+        Book* book);
+void* tournament_worker(void* arg);
+bool next_task(Tournament* tournament, int id, int* task);
+void play_match(Tournament* tournament, Match* match);
+void make_deck(CardArray* deck, uint64_t seed, int length);
+uint64_t next_random(uint64_t* state);
+uint64_t mix_bits(uint64_t z);
+void print_ratings(Tournament* tournament, double seconds);
+
 /* Setup Functions */
+bool new_game(Game* game);
 bool deal_cards(Game* game);
 void malloc_var(Game* game);
 
+/* Every AI strategy, in the order tournament results are reported */
+const Strategy strategies[] = {
+    {AI_BASIC, "basic", return_move},
+    {AI_PONDER, "ponder", choose_greedy},
+    {AI_ENDGAME, "endgame", choose_endgame},
+};
+const int numStrategies = sizeof(strategies) / sizeof(Strategy);
+
+/* The feed this process publishes to (or NULL), so that every exit can
+ * finish it */
+Feed* openFeed = NULL;
+char* openFeedName = NULL;
+
 int main(int argc, char** argv) {
-    Game game;
-    CardArray deck;
-    CardArray h1;
-    CardArray h2;
-    game.deck = deck;
-    game.hands[PLAYER_ONE] = h1;
-    game.hands[PLAYER_TWO] = h2;
-    if (argc == 4) {
+    Game game = {0};
+    if (argc > 1 && !strcmp(argv[1], "--tournament")) {
+        if (argc != 6 && argc != 7) {
+            exit_game(ERROR_BAD_ARGS);
+        }
+        int seeds = read_int(argv[4]);
+        int threads = read_int(argv[5]);
+        Book* book = NULL;
+        if (seeds < 1 || threads < 1 || threads > TOURNAMENT_MAX_THREADS
+                || (argc == 7 && !(book = book_open(argv[6])))) {
+            exit_game(ERROR_BAD_ARGS);
+        }
+        // The environment's book is not used, so results only depend on
+        // the arguments
+        printf("Opening book: %s\n", book ? argv[6] : "none");
+        run_tournament(check_dimension(argv[2]), check_dimension(argv[3]),
+                seeds, threads, book);
+        exit_game(0);
+    } else if (argc > 1 && !strcmp(argv[1], "--spectate")) {
+        if (argc != 3) {
+            exit_game(ERROR_BAD_ARGS);
+        }
+        spectate(argv[2]);
+        exit_game(0);
+    } else if (argc > 1 && !strcmp(argv[1], "--solve")) {
+        if (argc != 3) {
+            exit_game(ERROR_BAD_ARGS);
+        }
+        parse_save_file(&game, argv[2]);
+        if (deal_cards(&game)) {
+            analyse(&game);
+        } else {
+            calc_scores(&game);
+        }
+        exit_game(0);
+    } else if (argc > 1 && !strcmp(argv[1], "--paths")) {
+        if (argc != 3) {
+            exit_game(ERROR_BAD_ARGS);
+        }
+        parse_save_file(&game, argv[2]);
+        print_paths(&game);
+        exit_game(0);
+    } else if (argc > 1 && !strcmp(argv[1], "--book")) {
+        if (argc < 8) {
+            exit_game(ERROR_BAD_ARGS);
+        }
+        int plies = read_int(argv[5]);
+        int depth = read_int(argv[6]);
+        if (plies < 1 || depth < 1) {
+            exit_game(ERROR_BAD_ARGS);
+        }
+        build_book(argv[2], check_dimension(argv[3]), check_dimension(argv[4]),
+                plies, depth, argc - 7, argv + 7);
+        exit_game(0);
+    } else if (argc > 1 && !strcmp(argv[1], "--archive")) {
+        if (argc == 3) {
+            archive_list(argv[2]);
+        } else if (argc > 3 && argc % 2 == 1) {
+            archive_pack(argv[2], (argc - 3) / 2, argv + 3);
+        } else {
+            exit_game(ERROR_BAD_ARGS);
+        }
+        exit_game(0);
+    } else if (argc == 4) {
         // Loading from a save
         game.playerType[PLAYER_ONE] = check_player(argv[2]);
         game.playerType[PLAYER_TWO] = check_player(argv[3]);
@@ -141,18 +773,18 @@ int main(int argc, char** argv) {
         game.playerType[PLAYER_TWO] = check_player(argv[5]);
         game.cardsDrawn = 0;
         parse_deck_file(&game);
-        game.status = NEW_GAME;
-        game.hands[PLAYER_ONE].length = 0;
-        game.hands[PLAYER_TWO].length = 0;
-        game.turn = PLAYER_ONE;
-        malloc_var(&game);
-        if (!deal_cards(&game)) {
+        if (!new_game(&game)) {
             exit_game(ERROR_SHORT_DECK);
         }
-        game.turn = TURN_ONE;
     } else {
         exit_game(ERROR_BAD_ARGS);
     }
+    if (getenv(FEED_ENV)) {
+        feed_open(&game, getenv(FEED_ENV));
+    }
+    if (getenv(BOOK_ENV)) {
+        game.book = book_open(getenv(BOOK_ENV));
+    }
     game_loop(&game);
     exit_game(0);
     return 0;
@@ -208,7 +840,7 @@ int read_int(char* line) {
  * @param line The user input string.
  */
 char check_player(char* line) {
-    if (strlen(line) != 1 || (line[0] != 'h' && line[0] != 'a')) {
+    if (strlen(line) != 1 || (line[0] != HUMAN && !find_strategy(line[0]))) {
         exit_game(ERROR_PLAYER_INVALID);
     }
 
@@ -228,18 +860,41 @@ int check_dimension(char* line) {
     return len;
 }
 
-/* Read from the save File, catching any errors
+/* Read from the save File, catching any errors. A name of the form
+ * archive:key reads that save from an archive instead.
  *
  * @param game - information about the game state
  * @param fileName - The name of the file to read from
  */
 void parse_save_file(Game* game, char* fileName) {
     FILE* f;
+    char* path;
+    char* key;
+    if (split_archive_name(fileName, &path, &key)) {
+        size_t length;
+        char* text = archive_load(path, key, &length);
+        free(path);
+        if (!text || !(f = fmemopen(text, length, "r"))) {
+            exit_game(ERROR_SAVE_READ);
+        }
+        parse_save_stream(game, f);
+        free(text);
+        return;
+    }
+
     f = fopen(fileName, "r");
     if (!f) {
         exit_game(ERROR_SAVE_READ);
     }
+    parse_save_stream(game, f);
+}
 
+/* Read a save from an open stream, catching any errors, then close it.
+ *
+ * @param game - information about the game state
+ * @param f - The stream to read from
+ */
+void parse_save_stream(Game* game, FILE* f) {
     int lineN = 0;
     char* line;
     while (read_line(f, &line)) {
@@ -248,9 +903,11 @@ void parse_save_file(Game* game, char* fileName) {
                 parse_line_one(line, game);
                 break;
             case 1:
+                // Kept for save_game, so not freed
                 game->deckFile = line;
                 parse_deck_file(game);
-                break;
+                lineN++;
+                continue;
             case 2:
             case 3:
                 parse_hands(game, line, lineN - 1);
@@ -261,13 +918,13 @@ void parse_save_file(Game* game, char* fileName) {
         free(line);
         lineN++;
     }
+    fclose(f);
     // Check that all lines are read and the board height is correct.
     if (lineN != game->height + 4) {
         exit_game(ERROR_SAVE_READ);
     } else if (board_full(game)) {
         exit_game(ERROR_FULL_BOARD);
     }
-    fclose(f);
 }
 
 /* Check that the first line of save file is valid and populate the game
@@ -392,6 +1049,14 @@ void exit_game(int exitCode) {
         case ERROR_BAD_ARGS:
             fprintf(stderr, "Usage: bark savefile p1type p2type\n");
             fprintf(stderr, "bark deck width height p1type p2type\n");
+            fprintf(stderr, "bark --tournament width height seeds threads "
+                    "[bookfile]\n");
+            fprintf(stderr, "bark --spectate feedname\n");
+            fprintf(stderr, "bark --solve savefile\n");
+            fprintf(stderr, "bark --paths savefile\n");
+            fprintf(stderr, "bark --archive archive [key savefile ...]\n");
+            fprintf(stderr, "bark --book bookfile width height plies depth "
+                    "deck ...\n");
             break;
         case ERROR_PLAYER_INVALID:
             fprintf(stderr, "Incorrect arg types\n");
@@ -411,7 +1076,14 @@ void exit_game(int exitCode) {
         case ERROR_END_HUMAN_INPUT:
             fprintf(stderr, "End of input\n");
             break;
+        case ERROR_FEED_READ:
+            fprintf(stderr, "Unable to read feed\n");
+            break;
+        case ERROR_ARCHIVE_WRITE:
+            fprintf(stderr, "Unable to write archive\n");
+            break;
     }
+    feed_close(exitCode);
     exit(exitCode);
 }
 
@@ -421,11 +1093,18 @@ void exit_game(int exitCode) {
  * @param game - information about the game state
  */
 void game_loop(Game* game) {
-    while (game->status && !board_full(game) && deal_cards(game)) {
+    while (game->status && !board_full(game) && history_deal(game)) {
+        feed_publish(game, false);
         print_board(game);
-        player_handler(game);
-        game->turn = (game->turn == TURN_ONE) ? TURN_TWO : TURN_ONE;
+        if (player_handler(game)) {
+            history_move(game);
+            feed_event(game, FEED_MOVE);
+            game->turn = (game->turn == TURN_ONE) ? TURN_TWO : TURN_ONE;
+        } else {
+            feed_event(game, FEED_REWIND);
+        }
     }
+    feed_publish(game, true);
     print_board(game);
     calc_scores(game);
 }
@@ -433,47 +1112,69 @@ void game_loop(Game* game) {
 /* Read player input and make a move
  *
  * @parm game - information about the game state
+ * @return false if turns were undone or redone instead
  */
-void player_handler(Game* game) {
+bool player_handler(Game* game) {
     print_deck(game);
-    if (game->playerType[game->turn - 1] == 'a') {
-        return_move(game);
-        return;
+    if (game->playerType[game->turn - 1] != HUMAN) {
+        ai_move(game);
+        return true;
     }
     char* line;
+    int result;
+    ponder_start(game);
     while (1) {
         printf("Move? ");
         if (!read_line(stdin, &line)) {
             exit_game(ERROR_END_HUMAN_INPUT);
-        } else if (check_input(game, line)) {
+        } else if ((result = check_input(game, line)) != INPUT_INVALID) {
             break;
         }
         free(line);
     }
     free(line);
+    ponder_stop(game);
+    if (result == INPUT_REWIND) {
+        // The position pondered on is gone
+        ponder_discard(game);
+        return false;
+    }
+    return true;
 }
 
 /* Check if the players move is valid;
  *
  * @param game - information about the game state
  * @parmam line - the players input.
+ * @return INPUT_MOVE if a move was made, INPUT_REWIND if turns were
+ *      undone or redone, INPUT_INVALID otherwise.
  */
-bool check_input(Game* game, char* line) {
+int check_input(Game* game, char* line) {
     int length = strlen(line);
     char save[5];
-    if (length < 5) {
+    if (!strcmp(line, "UNDO")) {
+        return undo_turns(game) ? INPUT_REWIND : INPUT_INVALID;
+    } else if (!strcmp(line, "SOLVE")) {
+        analyse(game);
+        return INPUT_INVALID;
+    } else if (!strcmp(line, "PATHS")) {
+        print_paths(game);
+        return INPUT_INVALID;
+    } else if (!strcmp(line, "REDO")) {
+        return redo_turns(game) ? INPUT_REWIND : INPUT_INVALID;
+    } else if (length < 5) {
         // Both moves and SAVEs are longer than 5
-        return false;
+        return INPUT_INVALID;
     }
 
     strncpy(save, line, 4);
     save[4] = '\0';
     // strcmp returns 0 if there is a match
     if (strcmp(save, "SAVE")) {
-        return check_entry(game, line);
+        return check_entry(game, line) ? INPUT_MOVE : INPUT_INVALID;
     } else {
         save_game(game, line + 4);
-        return false;
+        return INPUT_INVALID;
     }
 }
 
@@ -520,8 +1221,11 @@ bool check_entry(Game* game, char* line) {
     return true;
 }
 
-/* Save the game to a file
- *`
+/* Save the game to a file, or to an existing archive for archive:key.
+ * Each save into an archive rewrites its index, so a save costs time in
+ * proportion to the saves already there; pack many at once with
+ * bark --archive.
+ *
  * @param game - information about the game state
  * @param fileName - the file to save to
  */
@@ -537,12 +1241,39 @@ void save_game(Game* game, char* fileName) {
         }
     }
 
+    char* path;
+    char* key;
+    if (split_archive_name(fileName, &path, &key)) {
+        char* text;
+        size_t length;
+        FILE* f = open_memstream(&text, &length);
+        if (f) {
+            write_save(game, f);
+            fclose(f);
+        }
+        if (!f || !archive_append(path, 1, &key, &text, &length)) {
+            printf("Unable to save\n");
+        }
+        free(f ? text : NULL);
+        free(path);
+        return;
+    }
+
     FILE* f = fopen(fileName, "w");
     if (!f) {
         printf("Unable to save\n");
         return;
     }
+    write_save(game, f);
+    fclose(f);
+}
 
+/* Write the game in save file format.
+ *
+ * @param game - information about the game state
+ * @param f - the stream to write to
+ */
+void write_save(Game* game, FILE* f) {
     fprintf(f, "%d %d %d %d\n", game->width, game->height,
             game->cardsDrawn, game->turn);
     fprintf(f, "%s\n", game->deckFile);
@@ -583,6 +1314,140 @@ void make_move(Game* game, int row, int col, int c) {
     game->board[row][col].num = temp.num;
     game->board[row][col].suit = temp.suit;
     game->status = (game->status == NEW_GAME) ? MIDDLE_GAME : game->status;
+    game->lastMove = (Move){.card = c, .row = row, .col = col};
+    path_invalidate(game, row, col);
+}
+
+/* Take back a move made by make_move, putting the card back in its hand
+ * slot. The player must still be the one to move.
+ *
+ * @param game - information about the game state
+ * @param move - The move to take back
+ * @param card - The card that was played
+ * @param status - The status before the move
+ */
+void unmake_move(Game* game, Move move, Card card, int status) {
+    CardArray* hand = &game->hands[game->turn - 1];
+    for (int k = HAND_SIZE - 1; k > move.card; k--) {
+        // Shuffle cards up.
+        hand->cards[k] = hand->cards[k - 1];
+    }
+    hand->cards[move.card] = card;
+    hand->length++;
+    path_invalidate(game, move.row, move.col);
+    game->board[move.row][move.col] = (Card){.num = '*', .suit = '*'};
+    game->status = status;
+}
+
+/* Record the state before dealing, then deal.
+ *
+ * @param game - information about the game state
+ * @return The result of deal_cards
+ */
+bool history_deal(Game* game) {
+    record_deal(game, &game->history.pending);
+    return deal_cards(game);
+}
+
+/* Record what undo_deal needs to take back the next deal.
+ *
+ * @param game - information about the game state
+ * @param record - Where to save the state
+ */
+void record_deal(Game* game, TurnRecord* record) {
+    record->turn = game->turn;
+    record->status = game->status;
+    record->cardsDrawn = game->cardsDrawn;
+    for (int i = 0; i < NUM_PLAYERS; i++) {
+        record->handLength[i] = game->hands[i].length;
+    }
+}
+
+/* Push the turn in progress once its move is made. Any turns that
+ * could have been redone are forgotten.
+ *
+ * @param game - information about the game state
+ */
+void history_move(Game* game) {
+    History* history = &game->history;
+    if (history->size == history->capacity) {
+        history->capacity = (history->capacity) ? history->capacity * 2
+                : HISTORY_START;
+        history->records = realloc(history->records,
+                sizeof(TurnRecord) * history->capacity);
+    }
+
+    TurnRecord* record = &history->records[history->size++];
+    *record = history->pending;
+    record->move = game->lastMove;
+    record->card = game->board[record->move.row][record->move.col];
+    history->count = history->size;
+}
+
+/* Put the deck, hands and status back to before a turn's deal.
+ *
+ * @param game - information about the game state
+ * @param record - The turn to go back to the start of
+ */
+void undo_deal(Game* game, TurnRecord* record) {
+    game->turn = record->turn;
+    game->status = record->status;
+    game->cardsDrawn = record->cardsDrawn;
+    for (int i = 0; i < NUM_PLAYERS; i++) {
+        game->hands[i].length = record->handLength[i];
+    }
+}
+
+/* Take back turns until it is a human's turn that was already played,
+ * so AI replies are taken back along with the human's move.
+ *
+ * @param game - information about the game state, mid turn
+ * @return false if no human turn has been played
+ */
+bool undo_turns(Game* game) {
+    History* history = &game->history;
+    int target = history->size - 1;
+    while (target >= 0 && game->playerType[history->records[target].turn
+            - 1] != HUMAN) {
+        target--;
+    }
+    if (target < 0) {
+        printf("Unable to undo\n");
+        return false;
+    }
+
+    undo_deal(game, &history->pending);
+    while (history->size > target) {
+        TurnRecord* record = &history->records[--history->size];
+        game->turn = record->turn;
+        unmake_move(game, record->move, record->card, record->status);
+        undo_deal(game, record);
+    }
+    return true;
+}
+
+/* Play undone turns again, up to the next human turn.
+ *
+ * @param game - information about the game state, mid turn
+ * @return false if there is nothing to redo
+ */
+bool redo_turns(Game* game) {
+    History* history = &game->history;
+    if (history->size == history->count) {
+        printf("Unable to redo\n");
+        return false;
+    }
+
+    undo_deal(game, &history->pending);
+    do {
+        TurnRecord* record = &history->records[history->size++];
+        deal_cards(game);
+        make_move(game, record->move.row, record->move.col,
+                record->move.card);
+        game->turn = (game->turn == TURN_ONE) ? TURN_TWO : TURN_ONE;
+    } while (history->size < history->count && game->playerType[
+            history->records[history->size].turn - 1] != HUMAN);
+    return true;
 }
 
 /* Calculate the players scores.
@@ -590,7 +1455,22 @@ void make_move(Game* game, int row, int col, int c) {
  * @param game - information about the game state
  */
 void calc_scores(Game* game) {
-    int pLength[NUM_PLAYERS] = {0, 0}; // Default length of 0.
+    int pLength[NUM_PLAYERS];
+    score_board(game, pLength);
+    printf("Player 1=%d Player 2=%d\n", 
+            pLength[PLAYER_ONE], pLength[PLAYER_TWO]);
+}
+
+/* Find each players longest path without printing.
+ *
+ * @param game - information about the game state
+ * @param scores - Where to save the scores, one per player
+ */
+void score_board(Game* game, int* scores) {
+#ifdef BARK_REFERENCE
+    int* pLength = scores;
+    pLength[PLAYER_ONE] = 0; // Default length of 0.
+    pLength[PLAYER_TWO] = 0;
     for (int i = 0; i < game->height; i++) {
         for (int j = 0; j < game->width; j++) {
             if (game->board[i][j].suit == '*') {
@@ -602,8 +1482,10 @@ void calc_scores(Game* game) {
                     PLAYER_ONE : PLAYER_TWO], game->board[i][j].suit);
         }
     }
-    printf("Player 1=%d Player 2=%d\n", 
-            pLength[PLAYER_ONE], pLength[PLAYER_TWO]);
+#else
+    scores[PLAYER_ONE] = longest_path(game, PLAYER_ONE, 0, NULL);
+    scores[PLAYER_TWO] = longest_path(game, PLAYER_TWO, 0, NULL);
+#endif
 }
 
 /* A recursive call to find the length of a path
@@ -672,37 +1554,275 @@ bool get_neighbour(Game* game, Card c, int row, int col, int** coords,
     return (j == 0) ? false : true; // Did we read any coords?
 }
 
-/* Check if a card is valid
+/* Get the game's path cache, making an empty one the first time.
  *
- * @param suit - The cards letter value
- * @param num - The cards numerical value
+ * @param game - information about the game state
  */
-bool check_card(char suit, char num) {
-    if (suit == '*' && num == '*') {
-        return true;
-    } else if (suit > 90 || suit < 65 || num > 57 || num < 49) {
-        return false;
+PathCache* path_cache(Game* game) {
+    if (!game->paths) {
+        int cells = game->width * game->height;
+        game->paths = malloc(sizeof(PathCache));
+        game->paths->best = malloc(sizeof(int) * cells * NUM_SUITS);
+        game->paths->next = malloc(sizeof(int) * cells * NUM_SUITS);
+        game->paths->valid = calloc(cells, sizeof(bool));
     }
-    return true;
+    return game->paths;
 }
 
-/* Make an AI move.
+/* Bring a cell's longest paths up to date, after the cells it leads to.
+ * Numbers strictly increase along a path, so this recurs at most
+ * PATH_MAX_LENGTH deep.
  *
- * @param game - information about the game state.
+ * @param game - information about the game state
+ * @param cache - The game's path cache
+ * @param row - board row
+ * @param col - board column
  */
-void return_move(Game* game) {
-    int player = game->turn - 1;
-    Card temp = game->hands[player].cards[0]; // Always select first card
-    int column;
-    int row;
-    if (game->status == NEW_GAME) {
-        row = (game->height - 1) / 2;
-        column = (game->width - 1) / 2;
-    } else {
-        for (int i = 0; i < game->height; i++) {
-            for (int j = 0; j < game->width; j++) {
-                row = (player != PLAYER_ONE) ? game->height - i - 1 : i;
-                column = (player != PLAYER_ONE) ? game->width - j - 1 : j;
+void path_cell(Game* game, PathCache* cache, int row, int col) {
+    int cell = row * game->width + col;
+    int* best = &cache->best[cell * NUM_SUITS];
+    int* next = &cache->next[cell * NUM_SUITS];
+    Card c = game->board[row][col];
+    int nRow, nCol;
+    if (cache->valid[cell]) {
+        return;
+    }
+
+    for (int s = 0; s < NUM_SUITS; s++) {
+        best[s] = (c.suit == 'A' + s) ? 1 : 0;
+        next[s] = -1;
+    }
+    for (int d = 0; d < NUM_DIRECTIONS && c.suit != '*'; d++) {
+        if (!neighbour_cell(game, row, col, d, &nRow, &nCol)
+                || game->board[nRow][nCol].num <= c.num) {
+            continue;
+        }
+        path_cell(game, cache, nRow, nCol);
+        int nCell = nRow * game->width + nCol;
+        for (int s = 0; s < NUM_SUITS; s++) {
+            int length = cache->best[nCell * NUM_SUITS + s];
+            if (length && length + 1 > best[s]) {
+                best[s] = length + 1;
+                next[s] = nCell;
+            }
+        }
+    }
+    cache->valid[cell] = true;
+}
+
+/* Forget the paths through a cell whose card is about to be taken or
+ * has just been placed, and the paths of every cell leading to it.
+ *
+ * @param game - information about the game state
+ * @param row - board row
+ * @param col - board column
+ */
+void path_invalidate(Game* game, int row, int col) {
+    if (game->paths) {
+        // Cells leading to a new card may still be valid, so always look
+        game->paths->valid[row * game->width + col] = true;
+        path_forget(game, row, col, game->board[row][col]);
+    }
+}
+
+/* Mark a cell invalid, along with every valid cell leading to it.
+ *
+ * @param game - information about the game state
+ * @param row - board row
+ * @param col - board column
+ * @param c - The card in the cell
+ */
+void path_forget(Game* game, int row, int col, Card c) {
+    PathCache* cache = game->paths;
+    int nRow, nCol;
+    if (!cache->valid[row * game->width + col]) {
+        // Any cell leading here is already invalid
+        return;
+    }
+
+    cache->valid[row * game->width + col] = false;
+    for (int d = 0; d < NUM_DIRECTIONS; d++) {
+        if (neighbour_cell(game, row, col, d, &nRow, &nCol)
+                && game->board[nRow][nCol].num < c.num) {
+            path_forget(game, nRow, nCol, game->board[nRow][nCol]);
+        }
+    }
+}
+
+/* Find a neighbouring card, treating the board as a torus. Directions
+ * are checked in the same order as get_neighbour.
+ *
+ * @param game - information about the game state
+ * @param row - board row
+ * @param col - board column
+ * @param direction - 0 to 3 for down, right, up and left
+ * @param nRow - Where to save the neighbours row
+ * @param nCol - Where to save the neighbours column
+ * @return false if the neighbouring cell is empty
+ */
+bool neighbour_cell(Game* game, int row, int col, int direction,
+        int* nRow, int* nCol) {
+    int x[NUM_DIRECTIONS] = {1, 0, -1, 0};
+    int y[NUM_DIRECTIONS] = {0, 1, 0, -1};
+    *nRow = (row + x[direction] + game->height) % game->height;
+    *nCol = (col + y[direction] + game->width) % game->width;
+    return game->board[*nRow][*nCol].suit != '*';
+}
+
+/* Find a player's longest path, or the longest path for one suit. A
+ * path starts and ends with the same suit and its numbers increase.
+ *
+ * @param game - information about the game state
+ * @param player - PLAYER_ONE or PLAYER_TWO, used if suit is 0
+ * @param suit - The suit to find a path for, or 0 for any of the players
+ * @param cells - Where to save the cells (row * width + col) in order,
+ *      PATH_MAX_LENGTH at most, or NULL
+ * @return The number of cards in the path, 0 if there is none
+ */
+int longest_path(Game* game, int player, char suit, int* cells) {
+    PathCache* cache = path_cache(game);
+    int longest = 0;
+    int start = -1;
+    for (int i = 0; i < game->height; i++) {
+        for (int j = 0; j < game->width; j++) {
+            Card c = game->board[i][j];
+            if (c.suit == '*' || (suit && c.suit != suit) || (!suit
+                    && ((c.suit % 2 != 0) ? PLAYER_ONE : PLAYER_TWO)
+                    != player)) {
+                continue;
+            }
+            path_cell(game, cache, i, j);
+            int cell = i * game->width + j;
+            if (cache->best[cell * NUM_SUITS + c.suit - 'A'] > longest) {
+                longest = cache->best[cell * NUM_SUITS + c.suit - 'A'];
+                start = cell;
+            }
+        }
+    }
+
+    if (cells && start != -1) {
+        // Follow the cached path back out
+        int s = game->board[start / game->width][start % game->width].suit
+                - 'A';
+        for (int k = 0, cell = start; cell != -1; k++) {
+            cells[k] = cell;
+            cell = cache->next[cell * NUM_SUITS + s];
+        }
+    }
+    return longest;
+}
+
+/* Find a path for print_paths. The reference build finds only its length,
+ * with the exhaustive search it scores with, so that make fuzz can check
+ * longest_path against it.
+ *
+ * @param game - information about the game state
+ * @param player - PLAYER_ONE or PLAYER_TWO, used if suit is 0
+ * @param suit - The suit to find a path for, or 0 for any of the players
+ * @param cells - Where to save the cells, as for longest_path
+ * @param found - Where to save the number of cells saved
+ * @return The number of cards in the path, 0 if there is none
+ */
+int find_path(Game* game, int player, char suit, int* cells, int* found) {
+#ifdef BARK_REFERENCE
+    int longest = 0;
+    for (int i = 0; i < game->height; i++) {
+        for (int j = 0; j < game->width; j++) {
+            Card c = game->board[i][j];
+            if (c.suit == '*' || (suit && c.suit != suit) || (!suit
+                    && ((c.suit % 2 != 0) ? PLAYER_ONE : PLAYER_TWO)
+                    != player)) {
+                continue;
+            }
+            get_path_length(game, i, j, 1, &longest, c.suit);
+        }
+    }
+    *found = 0;
+    return longest;
+#else
+    *found = longest_path(game, player, suit, cells);
+    return *found;
+#endif
+}
+
+/* Print the cards of a path along with their column and row.
+ *
+ * @param game - information about the game state
+ * @param length - The number of cards in the path
+ * @param cells - The cells of the path, as from longest_path
+ */
+void print_path(Game* game, int length, int* cells) {
+    for (int k = 0; k < length; k++) {
+        Card c = game->board[cells[k] / game->width][cells[k] % game->width];
+        printf(" %c%c(%d,%d)", c.num, c.suit, cells[k] % game->width + 1,
+                cells[k] / game->width + 1);
+    }
+    printf("\n");
+}
+
+/* Print each player's longest path, then the longest path for each suit
+ * on the board. The reference build prints lengths without cells.
+ *
+ * @param game - information about the game state
+ */
+void print_paths(Game* game) {
+    int cells[PATH_MAX_LENGTH];
+    int length, found;
+    bool onBoard[NUM_SUITS] = {false};
+    for (int i = 0; i < NUM_PLAYERS; i++) {
+        length = find_path(game, i, 0, cells, &found);
+        printf("Player %d=%d:", i + 1, length);
+        print_path(game, found, cells);
+    }
+
+    for (int i = 0; i < game->height; i++) {
+        for (int j = 0; j < game->width; j++) {
+            if (game->board[i][j].suit != '*') {
+                onBoard[game->board[i][j].suit - 'A'] = true;
+            }
+        }
+    }
+    for (int s = 0; s < NUM_SUITS; s++) {
+        if (onBoard[s]) {
+            length = find_path(game, 0, 'A' + s, cells, &found);
+            printf("Suit %c=%d:", 'A' + s, length);
+            print_path(game, found, cells);
+        }
+    }
+}
+
+/* Check if a card is valid
+ *
+ * @param suit - The cards letter value
+ * @param num - The cards numerical value
+ */
+bool check_card(char suit, char num) {
+    if (suit == '*' && num == '*') {
+        return true;
+    } else if (suit > 90 || suit < 65 || num > 57 || num < 49) {
+        return false;
+    }
+    return true;
+}
+
+/* The basic AI strategy. Always plays the first card, to the centre
+ * of an empty board or else the first free cell found.
+ *
+ * @param game - information about the game state.
+ * @param move - Where to save the move
+ */
+bool return_move(Game* game, Move* move) {
+    int player = game->turn - 1;
+    int column;
+    int row;
+    if (game->status == NEW_GAME) {
+        row = (game->height - 1) / 2;
+        column = (game->width - 1) / 2;
+    } else {
+        for (int i = 0; i < game->height; i++) {
+            for (int j = 0; j < game->width; j++) {
+                row = (player != PLAYER_ONE) ? game->height - i - 1 : i;
+                column = (player != PLAYER_ONE) ? game->width - j - 1 : j;
                 if (adjacent_to(game, row, column)) {
                     // exit the loops
                     i = game->height;
@@ -711,9 +1831,1752 @@ void return_move(Game* game) {
             }
         }
     }
-    make_move(game, row, column, 0);
-    printf("Player %d plays %c%c in column %d row %d\n", player + 1, temp.num,
-            temp.suit, column + 1, row + 1);
+    *move = (Move){.card = 0, .row = row, .col = column};
+    return true;
+}
+
+/* Find the strategy for a player type.
+ *
+ * @param type - The player type
+ * @return The strategy, or NULL if the type is not an AI
+ */
+const Strategy* find_strategy(char type) {
+    for (int i = 0; i < numStrategies; i++) {
+        if (strategies[i].type == type) {
+            return &strategies[i];
+        }
+    }
+    return NULL;
+}
+
+/* Make a move for whichever AI type is to play.
+ *
+ * @param game - information about the game state.
+ */
+void ai_move(Game* game) {
+    int player = game->turn - 1;
+    Move move;
+    if (!ponder_lookup(game, &move)) {
+        // Nothing was found while the human was thinking
+        find_strategy(game->playerType[player])->choose(game, &move);
+    }
+    Card temp = game->hands[player].cards[move.card];
+    make_move(game, move.row, move.col, move.card);
+    printf("Player %d plays %c%c in column %d row %d\n", player + 1, temp.num,
+            temp.suit, move.col + 1, move.row + 1);
+}
+
+/* The greedy AI strategy, see search_greedy.
+ *
+ * @param game - information about the game state.
+ * @param move - Where to save the move
+ */
+bool choose_greedy(Game* game, Move* move) {
+    return book_move(game, move) || search_greedy(game, move, NULL);
+}
+
+/* Find the move which leaves the current player furthest ahead.
+ * Ties go to the earliest card, then the earliest cell.
+ *
+ * @param game - information about the game state.
+ * @param best - Where to save the move found
+ * @param ponder - Checked for a stop request between moves (or NULL)
+ * @return false if stopped before every move was checked
+ */
+bool search_greedy(Game* game, Move* best, Ponder* ponder) {
+    int turn = game->turn - 1;
+    int bestValue = 0;
+    int value;
+    bool found = false;
+    for (int c = 0; c < game->hands[turn].length; c++) {
+        if (duplicate_card(&game->hands[turn], c)) {
+            continue;
+        }
+        for (int i = 0; i < game->height; i++) {
+            for (int j = 0; j < game->width; j++) {
+                if (!legal_move(game, i, j)) {
+                    continue;
+                } else if (ponder_stopped(ponder)) {
+                    return false;
+                }
+                Move move = (Move){.card = c, .row = i, .col = j};
+                value = evaluate_move(game, move);
+                if (!found || value > bestValue) {
+                    bestValue = value;
+                    *best = move;
+                    found = true;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+/* Score a move as the players score less the opponents, leaving the
+ * game unchanged.
+ *
+ * @param game - information about the game state.
+ * @param move - The move to try
+ */
+int evaluate_move(Game* game, Move move) {
+    int turn = game->turn - 1;
+    int scores[NUM_PLAYERS];
+    Card card = game->hands[turn].cards[move.card];
+    int status = game->status;
+    Move lastMove = game->lastMove;
+
+    make_move(game, move.row, move.col, move.card);
+    score_board(game, scores);
+    unmake_move(game, move, card, status);
+    game->lastMove = lastMove;
+    return scores[turn] - scores[1 - turn];
+}
+
+/* Check if a card appears earlier in a hand.
+ *
+ * @param hand - The hand to check
+ * @param c - position of the card in hand
+ */
+bool duplicate_card(CardArray* hand, int c) {
+    for (int k = 0; k < c; k++) {
+        if (hand->cards[k].num == hand->cards[c].num
+                && hand->cards[k].suit == hand->cards[c].suit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Order replies best first, keeping enumeration order for ties.
+ *
+ * @param a - The first RankedReply
+ * @param b - The second RankedReply
+ */
+int compare_replies(const void* a, const void* b) {
+    const RankedReply* x = a;
+    const RankedReply* y = b;
+    if (x->value != y->value) {
+        return y->value - x->value;
+    }
+    return x->order - y->order;
+}
+
+/* Start searching the human's replies in the background, if the
+ * opponent is a pondering AI.
+ *
+ * @param game - information about the game state, human to move.
+ */
+void ponder_start(Game* game) {
+    int other = (game->turn == TURN_ONE) ? PLAYER_TWO : PLAYER_ONE;
+    if (game->playerType[other] != AI_PONDER || game->ponder) {
+        return;
+    }
+
+    Ponder* ponder = malloc(sizeof(Ponder));
+    pthread_mutex_init(&ponder->lock, NULL);
+    ponder->stop = false;
+    copy_game(&ponder->position, game);
+    // The AI draws one card once the human has moved
+    ponder->cardsDrawn = game->cardsDrawn + 1;
+    ponder->entries = calloc(HAND_SIZE * game->height * game->width,
+            sizeof(PonderEntry));
+    if (pthread_create(&ponder->thread, NULL, ponder_run, ponder)) {
+        // Without a thread the AI simply searches on its turn
+        ponder_free(ponder);
+        return;
+    }
+    game->ponder = ponder;
+}
+
+/* Stop pondering and wait for the search to finish, keeping any
+ * answers found for the AI's turn.
+ *
+ * @param game - information about the game state.
+ */
+void ponder_stop(Game* game) {
+    Ponder* ponder = game->ponder;
+    if (!ponder) {
+        return;
+    }
+
+    pthread_mutex_lock(&ponder->lock);
+    ponder->stop = true;
+    pthread_mutex_unlock(&ponder->lock);
+    pthread_join(ponder->thread, NULL);
+}
+
+/* Check if pondering has been asked to stop.
+ *
+ * @param ponder - The pondering search (or NULL)
+ */
+bool ponder_stopped(Ponder* ponder) {
+    bool stop;
+    if (!ponder) {
+        return false;
+    }
+
+    pthread_mutex_lock(&ponder->lock);
+    stop = ponder->stop;
+    pthread_mutex_unlock(&ponder->lock);
+    return stop;
+}
+
+/* Pondering thread. Ranks the human's replies, then finds the AI's
+ * greedy answer to each, most likely reply first. Any time left over
+ * goes on searching the answers a move deeper at a time, so the longer
+ * the human thinks the stronger the answer.
+ *
+ * @param arg - The Ponder to fill in
+ */
+void* ponder_run(void* arg) {
+    Ponder* ponder = arg;
+    Game* position = &ponder->position;
+    Game base;
+    int human = position->turn - 1;
+    int size = HAND_SIZE * position->height * position->width;
+    RankedReply* replies = malloc(sizeof(RankedReply) * size);
+    int count = 0;
+
+    for (int c = 0; c < position->hands[human].length; c++) {
+        if (duplicate_card(&position->hands[human], c)) {
+            continue;
+        }
+        for (int i = 0; i < position->height; i++) {
+            for (int j = 0; j < position->width; j++) {
+                if (!adjacent_to(position, i, j)) {
+                    continue;
+                } else if (ponder_stopped(ponder)) {
+                    free(replies);
+                    return NULL;
+                }
+                replies[count].move = (Move){.card = c, .row = i, .col = j};
+                replies[count].value = evaluate_move(position,
+                        replies[count].move);
+                replies[count].order = count;
+                count++;
+            }
+        }
+    }
+    qsort(replies, count, sizeof(RankedReply), compare_replies);
+
+    copy_game(&base, position);
+    bool stopped = false;
+    for (int r = 0; r < count && !stopped; r++) {
+        PonderEntry entry = {.depth = 1};
+        if (!ponder_reply(position, replies[r].move)) {
+            entry.endsGame = true;
+        } else if (!book_move(position, &entry.answer)
+                && !search_greedy(position, &entry.answer, ponder)) {
+            stopped = true;
+        }
+        entry.ready = !stopped;
+        if (entry.ready) {
+            ponder_store(ponder, &base, replies[r].move, entry);
+        }
+        free_game(position);
+        copy_game(position, &base);
+    }
+
+    // Every answer is ready, so search them deeper until stopped or no
+    // answer can be searched any deeper within PONDER_NODE_LIMIT
+    int empty = base.height * base.width;
+    for (int i = 0; i < base.height; i++) {
+        for (int j = 0; j < base.width; j++) {
+            empty -= (base.board[i][j].suit != '*');
+        }
+    }
+    for (int depth = 2; depth <= empty && !stopped; depth++) {
+        bool deeper = false;
+        for (int r = 0; r < count && !stopped; r++) {
+            Move reply = replies[r].move;
+            PonderEntry entry = ponder->entries[(reply.card * base.height
+                    + reply.row) * base.width + reply.col];
+            int value;
+            long nodes;
+            if (entry.endsGame || entry.depth != depth - 1) {
+                continue;
+            }
+            ponder_reply(position, reply);
+            if (solve_root(position, &entry.answer, &value, &nodes, depth,
+                    PONDER_NODE_LIMIT, ponder)) {
+                entry.depth = depth;
+                ponder_store(ponder, &base, reply, entry);
+                deeper = true;
+            }
+            stopped = ponder_stopped(ponder);
+            free_game(position);
+            copy_game(position, &base);
+        }
+        stopped = stopped || !deeper;
+    }
+    free_game(&base);
+    free(replies);
+    return NULL;
+}
+
+/* Play a human reply while pondering and deal the AI its card.
+ *
+ * @param position - The position before the reply, changed to after it
+ * @param reply - The human's move
+ * @return false if the reply ends the game before the AI moves
+ */
+bool ponder_reply(Game* position, Move reply) {
+    make_move(position, reply.row, reply.col, reply.card);
+    position->turn = (position->turn == TURN_ONE) ? TURN_TWO : TURN_ONE;
+    return !board_full(position) && deal_cards(position);
+}
+
+/* Save the answer to a reply. Identical cards in the human's hand share
+ * an answer.
+ *
+ * @param ponder - The pondering search
+ * @param base - The position before the reply
+ * @param reply - The human's move
+ * @param entry - The answer
+ */
+void ponder_store(Ponder* ponder, Game* base, Move reply, PonderEntry entry) {
+    CardArray* hand = &base->hands[base->turn - 1];
+    for (int c = 0; c < HAND_SIZE; c++) {
+        if (hand->cards[c].num == hand->cards[reply.card].num
+                && hand->cards[c].suit == hand->cards[reply.card].suit) {
+            ponder->entries[(c * base->height + reply.row) * base->width
+                    + reply.col] = entry;
+        }
+    }
+}
+
+/* Take the answer found while pondering for the human's last move,
+ * then discard the pondering search.
+ *
+ * @param game - information about the game state, AI to move.
+ * @param move - Where to save the answer
+ * @return true if an answer was found
+ */
+bool ponder_lookup(Game* game, Move* move) {
+    Ponder* ponder = game->ponder;
+    bool found = false;
+    if (!ponder) {
+        return false;
+    }
+
+    Move reply = game->lastMove;
+    PonderEntry entry = ponder->entries[(reply.card * game->height
+            + reply.row) * game->width + reply.col];
+    if (entry.ready && !entry.endsGame
+            && ponder->cardsDrawn == game->cardsDrawn) {
+        *move = entry.answer;
+        found = true;
+    }
+    game->ponder = NULL;
+    ponder_free(ponder);
+    return found;
+}
+
+/* Throw away a stopped pondering search without using it.
+ *
+ * @param game - information about the game state.
+ */
+void ponder_discard(Game* game) {
+    if (game->ponder) {
+        ponder_free(game->ponder);
+        game->ponder = NULL;
+    }
+}
+
+/* Free a pondering search. The thread must not be running.
+ *
+ * @param ponder - The pondering search
+ */
+void ponder_free(Ponder* ponder) {
+    pthread_mutex_destroy(&ponder->lock);
+    free_game(&ponder->position);
+    free(ponder->entries);
+    free(ponder);
+}
+
+/* Split archive:key into its archive path and key. A name whose prefix
+ * is not an existing archive is a plain save file.
+ *
+ * @param name - The name to split
+ * @param path - Where to save the path, which must be freed
+ * @param key - Where to save the key, pointing into name
+ * @return true if name refers to an archive
+ */
+bool split_archive_name(char* name, char** path, char** key) {
+    char* separator = strchr(name, ARCHIVE_SEPARATOR);
+    ArchiveHeader header;
+    FILE* f;
+    if (!separator || separator == name || !separator[1]
+            || strlen(separator + 1) >= ARCHIVE_KEY_SIZE) {
+        return false;
+    }
+
+    *path = malloc(separator - name + 1);
+    memcpy(*path, name, separator - name);
+    (*path)[separator - name] = '\0';
+    if (!(f = fopen(*path, "rb"))) {
+        free(*path);
+        return false;
+    } else if (fread(&header, sizeof(ArchiveHeader), 1, f) != 1
+            || memcmp(header.magic, ARCHIVE_MAGIC, sizeof(header.magic))) {
+        fclose(f);
+        free(*path);
+        return false;
+    }
+    fclose(f);
+    *key = separator + 1;
+    return true;
+}
+
+/* Read and check an archive header. An empty file is an empty archive.
+ *
+ * @param f - The archive
+ * @param header - Where to save the header
+ */
+bool archive_read_header(FILE* f, ArchiveHeader* header) {
+    fseek(f, 0, SEEK_SET);
+    if (fread(header, sizeof(ArchiveHeader), 1, f) != 1) {
+        if (ftell(f) != 0) {
+            return false;
+        }
+        memcpy(header->magic, ARCHIVE_MAGIC, sizeof(header->magic));
+        header->indexOffset = sizeof(ArchiveHeader);
+        header->count = 0;
+        return true;
+    }
+    return !memcmp(header->magic, ARCHIVE_MAGIC, sizeof(header->magic));
+}
+
+/* Binary search the index for a key, reading only the entries probed.
+ *
+ * @param f - The archive
+ * @param header - The archive's header
+ * @param key - The key to find
+ * @param entry - Where to save the matching entry
+ */
+bool archive_find(FILE* f, ArchiveHeader* header, char* key,
+        ArchiveEntry* entry) {
+    uint64_t low = 0;
+    uint64_t high = header->count;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        fseek(f, header->indexOffset + middle * sizeof(ArchiveEntry),
+                SEEK_SET);
+        if (fread(entry, sizeof(ArchiveEntry), 1, f) != 1) {
+            return false;
+        }
+        int order = strncmp(key, entry->key, ARCHIVE_KEY_SIZE);
+        if (order == 0) {
+            return true;
+        } else if (order < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return false;
+}
+
+/* Load one save's text from an archive.
+ *
+ * @param path - The archive
+ * @param key - The save's key
+ * @param length - Where to save the text length
+ * @return The text, which must be freed, or NULL if it cannot be read
+ */
+char* archive_load(char* path, char* key, size_t* length) {
+    ArchiveHeader header;
+    ArchiveEntry entry;
+    char* text = NULL;
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+
+    if (archive_read_header(f, &header)
+            && archive_find(f, &header, key, &entry)) {
+        text = malloc(entry.length + 1);
+        fseek(f, entry.offset, SEEK_SET);
+        if (fread(text, 1, entry.length, f) != entry.length) {
+            free(text);
+            text = NULL;
+        } else {
+            text[entry.length] = '\0';
+            *length = entry.length;
+        }
+    }
+    fclose(f);
+    return text;
+}
+
+/* Order index entries by key.
+ *
+ * @param a - The first ArchiveEntry
+ * @param b - The second ArchiveEntry
+ */
+int compare_entries(const void* a, const void* b) {
+    return strncmp(((const ArchiveEntry*)a)->key,
+            ((const ArchiveEntry*)b)->key, ARCHIVE_KEY_SIZE);
+}
+
+/* Add saves to an archive, creating it if needed. A key already in the
+ * archive is replaced. The new saves and merged index are written after
+ * the old index, and only then does the header point at them, so an
+ * archive cut short by a crash or a full disk still has its old index.
+ * Old indexes are left behind until they take up as much space as the
+ * live saves, then the archive is compacted if it can be.
+ *
+ * @param path - The archive
+ * @param n - The number of saves
+ * @param keys - Each save's key
+ * @param texts - Each save's text
+ * @param lengths - Each save's text length
+ */
+bool archive_append(char* path, int n, char** keys, char** texts,
+        size_t* lengths) {
+    ArchiveHeader header;
+    FILE* f = fopen(path, "r+b");
+    if (!f && !(f = fopen(path, "w+b"))) {
+        return false;
+    } else if (!archive_read_header(f, &header)) {
+        fclose(f);
+        return false;
+    }
+
+    ArchiveEntry* index = malloc(sizeof(ArchiveEntry)
+            * (header.count + n));
+    fseek(f, header.indexOffset, SEEK_SET);
+    if (fread(index, sizeof(ArchiveEntry), header.count, f) != header.count) {
+        free(index);
+        fclose(f);
+        return false;
+    }
+
+    uint64_t offset = header.indexOffset
+            + header.count * sizeof(ArchiveEntry);
+    uint64_t count = header.count;
+    bool written = !fseek(f, offset, SEEK_SET);
+    for (int i = 0; i < n && written; i++) {
+        ArchiveEntry entry = {.offset = offset, .length = lengths[i]};
+        strncpy(entry.key, keys[i], ARCHIVE_KEY_SIZE - 1);
+        ArchiveEntry* old = bsearch(&entry, index, header.count,
+                sizeof(ArchiveEntry), compare_entries);
+        for (uint64_t j = header.count; !old && j < count; j++) {
+            // Not sorted yet
+            old = compare_entries(&entry, &index[j]) ? NULL : &index[j];
+        }
+        if (old) {
+            *old = entry;
+        } else {
+            index[count++] = entry;
+        }
+        written = fwrite(texts[i], 1, lengths[i], f) == lengths[i];
+        offset += lengths[i];
+    }
+    qsort(index, count, sizeof(ArchiveEntry), compare_entries);
+    written = written
+            && fwrite(index, sizeof(ArchiveEntry), count, f) == count;
+    // Everything the new header points at must be on disk first
+    written = written && !fflush(f) && !fsync(fileno(f));
+
+    header.indexOffset = offset;
+    header.count = count;
+    written = written && !fseek(f, 0, SEEK_SET)
+            && fwrite(&header, sizeof(ArchiveHeader), 1, f) == 1
+            && !fflush(f) && !fsync(fileno(f));
+
+    uint64_t live = sizeof(ArchiveHeader) + count * sizeof(ArchiveEntry);
+    for (uint64_t i = 0; i < count; i++) {
+        live += index[i].length;
+    }
+    if (written && offset + count * sizeof(ArchiveEntry) > 2 * live) {
+        // The saves are already safe, so compacting can be tried again
+        // on a later append if it fails now
+        archive_compact(path, f, index, count);
+    }
+    free(index);
+    return !fclose(f) && written;
+}
+
+/* Copy the live saves and index of an archive to a new file, then
+ * rename it over the archive.
+ *
+ * @param path - The archive
+ * @param f - The archive, open for reading
+ * @param index - The archive's index, which is updated
+ * @param count - The number of index entries
+ */
+bool archive_compact(char* path, FILE* f, ArchiveEntry* index,
+        uint64_t count) {
+    ArchiveHeader header = {.count = count};
+    char* temp = malloc(strlen(path) + 5);
+    sprintf(temp, "%s.tmp", path);
+    FILE* out = fopen(temp, "wb");
+    bool written = out
+            && !fseek(out, sizeof(ArchiveHeader), SEEK_SET);
+
+    uint64_t offset = sizeof(ArchiveHeader);
+    for (uint64_t i = 0; i < count && written; i++) {
+        char* text = malloc(index[i].length + 1);
+        written = !fseek(f, index[i].offset, SEEK_SET)
+                && fread(text, 1, index[i].length, f) == index[i].length
+                && fwrite(text, 1, index[i].length, out) == index[i].length;
+        free(text);
+        index[i].offset = offset;
+        offset += index[i].length;
+    }
+
+    memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+    header.indexOffset = offset;
+    written = written
+            && fwrite(index, sizeof(ArchiveEntry), count, out) == count
+            && !fseek(out, 0, SEEK_SET)
+            && fwrite(&header, sizeof(ArchiveHeader), 1, out) == 1
+            && !fflush(out) && !fsync(fileno(out));
+    if (out && fclose(out)) {
+        written = false;
+    }
+    written = written && !rename(temp, path);
+    if (!written) {
+        remove(temp);
+    }
+    free(temp);
+    return written;
+}
+
+/* Pack save files into an archive.
+ *
+ * @param path - The archive
+ * @param n - The number of saves
+ * @param args - Pairs of key and save file name
+ */
+void archive_pack(char* path, int n, char** args) {
+    char** keys = malloc(sizeof(char*) * n);
+    char** texts = malloc(sizeof(char*) * n);
+    size_t* lengths = malloc(sizeof(size_t) * n);
+    for (int i = 0; i < n; i++) {
+        FILE* f = fopen(args[2 * i + 1], "rb");
+        keys[i] = args[2 * i];
+        if (!f || !keys[i][0] || strlen(keys[i]) >= ARCHIVE_KEY_SIZE) {
+            exit_game(ERROR_SAVE_READ);
+        }
+        fseek(f, 0, SEEK_END);
+        lengths[i] = ftell(f);
+        texts[i] = malloc(lengths[i]);
+        fseek(f, 0, SEEK_SET);
+        if (fread(texts[i], 1, lengths[i], f) != lengths[i]) {
+            exit_game(ERROR_SAVE_READ);
+        }
+        fclose(f);
+    }
+
+    if (!archive_append(path, n, keys, texts, lengths)) {
+        exit_game(ERROR_ARCHIVE_WRITE);
+    }
+    for (int i = 0; i < n; i++) {
+        free(texts[i]);
+    }
+    free(lengths);
+    free(texts);
+    free(keys);
+}
+
+/* Stream every save in an archive into a game in key order, printing
+ * each key with who is to move and the scores.
+ *
+ * @param path - The archive
+ */
+void archive_list(char* path) {
+    ArchiveReader reader;
+    ArchiveEntry entry;
+    Game game = {0};
+    int scores[NUM_PLAYERS];
+    if (!archive_open(&reader, path)) {
+        exit_game(ERROR_SAVE_READ);
+    }
+
+    while (archive_next(&reader, &entry, &game)) {
+        score_board(&game, scores);
+        printf("%.*s: Player %d to move, %d cards drawn, Player 1=%d "
+                "Player 2=%d\n", ARCHIVE_KEY_SIZE, entry.key, game.turn,
+                game.cardsDrawn, scores[PLAYER_ONE], scores[PLAYER_TWO]);
+        free_game(&game);
+        free(game.deck.cards);
+        free(game.deckFile);
+        game = (Game){0};
+    }
+    archive_close(&reader);
+}
+
+/* Start reading an archive's saves.
+ *
+ * @param reader - The reader to set up
+ * @param path - The archive
+ * @return false if the archive cannot be read
+ */
+bool archive_open(ArchiveReader* reader, char* path) {
+    reader->index = fopen(path, "rb");
+    reader->saves = fopen(path, "rb");
+    reader->next = 0;
+    if (!reader->index || !reader->saves
+            || !archive_read_header(reader->index, &reader->header)) {
+        archive_close(reader);
+        return false;
+    }
+    fseek(reader->index, reader->header.indexOffset, SEEK_SET);
+    return true;
+}
+
+/* Read the next save into a game, as a save file is loaded. A save that
+ * cannot be read ends the program as it would when loading it.
+ *
+ * @param reader - The reader
+ * @param entry - Where to save the save's index entry
+ * @param game - A zeroed game to load into
+ * @return false once every save has been read
+ */
+bool archive_next(ArchiveReader* reader, ArchiveEntry* entry, Game* game) {
+    FILE* f;
+    if (reader->next == reader->header.count) {
+        return false;
+    } else if (fread(entry, sizeof(ArchiveEntry), 1, reader->index) != 1) {
+        exit_game(ERROR_SAVE_READ);
+    }
+    reader->next++;
+
+    char* text = malloc(entry->length + 1);
+    fseek(reader->saves, entry->offset, SEEK_SET);
+    if (fread(text, 1, entry->length, reader->saves) != entry->length
+            || !(f = fmemopen(text, entry->length, "r"))) {
+        exit_game(ERROR_SAVE_READ);
+    }
+    parse_save_stream(game, f);
+    free(text);
+    return true;
+}
+
+/* Finish reading an archive.
+ *
+ * @param reader - The reader
+ */
+void archive_close(ArchiveReader* reader) {
+    if (reader->index) {
+        fclose(reader->index);
+    }
+    if (reader->saves) {
+        fclose(reader->saves);
+    }
+}
+
+/* The size of a feed segment for a board.
+ *
+ * @param width - board width
+ * @param height - board height
+ */
+size_t feed_size(int width, int height) {
+    return sizeof(Feed) + sizeof(Card) * width * height;
+}
+
+/* Create (or replace) a named shared memory feed for the game. The game
+ * carries on without one if this fails. The name is removed again when
+ * the game exits, see feed_close.
+ *
+ * @param game - information about the game state
+ * @param name - The shm_open name, such as /bark
+ */
+void feed_open(Game* game, char* name) {
+    size_t size = feed_size(game->width, game->height);
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd == -1) {
+        fprintf(stderr, "Unable to open feed\n");
+        return;
+    } else if (ftruncate(fd, size) == -1) {
+        fprintf(stderr, "Unable to open feed\n");
+        close(fd);
+        return;
+    }
+
+    Feed* feed = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (feed == MAP_FAILED) {
+        fprintf(stderr, "Unable to open feed\n");
+        return;
+    }
+    // Start the version at zero so readers wait for the first snapshot
+    memset(feed, 0, size);
+    feed->width = game->width;
+    feed->height = game->height;
+    feed->deckLength = game->deck.length;
+    __atomic_store_n(&feed->version, FEED_VERSION, __ATOMIC_RELEASE);
+    __atomic_store_n(&feed->magic, FEED_MAGIC, __ATOMIC_RELEASE);
+    game->feed = feed;
+    openFeed = feed;
+    openFeedName = name;
+}
+
+/* Mark the open feed finished however the game exits, so spectators stop
+ * following it, then remove its name. Spectators already following keep
+ * their mapping and still see the final snapshot.
+ *
+ * @param exitCode - What the game is exiting with
+ */
+void feed_close(int exitCode) {
+    if (!openFeed) {
+        return;
+    }
+    feed_begin(openFeed);
+    openFeed->finished = true;
+    openFeed->exitCode = exitCode;
+    feed_end(openFeed);
+    shm_unlink(openFeedName);
+    openFeed = NULL;
+}
+
+/* Start a write, making seq odd.
+ *
+ * @param feed - The feed being written
+ */
+void feed_begin(Feed* feed) {
+    __atomic_store_n(&feed->seq, feed->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/* Finish a write, making seq even again.
+ *
+ * @param feed - The feed being written
+ */
+void feed_end(Feed* feed) {
+    __atomic_store_n(&feed->seq, feed->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Publish the board, hands and status.
+ *
+ * @param game - information about the game state
+ * @param finished - Whether the game is over
+ */
+void feed_publish(Game* game, bool finished) {
+    Feed* feed = game->feed;
+    if (!feed) {
+        return;
+    }
+
+    feed_begin(feed);
+    feed->finished = finished;
+    feed->turn = game->turn;
+    feed->status = game->status;
+    feed->cardsDrawn = game->cardsDrawn;
+    for (int i = 0; i < NUM_PLAYERS; i++) {
+        feed->handLength[i] = game->hands[i].length;
+        memcpy(feed->hands[i], game->hands[i].cards,
+                sizeof(Card) * HAND_SIZE);
+    }
+    for (int i = 0; i < game->height; i++) {
+        memcpy(&feed->board[i * game->width], game->board[i],
+                sizeof(Card) * game->width);
+    }
+    feed_end(feed);
+}
+
+/* Add an event to the ring. A move also goes straight onto the board.
+ *
+ * @param game - information about the game state
+ * @param kind - FEED_MOVE for game->lastMove, or FEED_REWIND
+ */
+void feed_event(Game* game, int kind) {
+    Feed* feed = game->feed;
+    if (!feed) {
+        return;
+    }
+
+    Move move = game->lastMove;
+    FeedEvent event = {.kind = kind, .turn = game->turn};
+    if (kind == FEED_MOVE) {
+        event.card = game->board[move.row][move.col];
+        event.row = move.row;
+        event.col = move.col;
+    }
+    feed_begin(feed);
+    feed->events[feed->numEvents % FEED_EVENTS] = event;
+    feed->numEvents++;
+    if (kind == FEED_MOVE) {
+        feed->board[move.row * game->width + move.col] = event.card;
+    }
+    feed_end(feed);
+}
+
+/* Follow a feed, printing each new snapshot and event until the game
+ * is finished.
+ *
+ * @param name - The shm_open name the game was given
+ */
+void spectate(char* name) {
+    struct stat info;
+    struct timespec poll = {.tv_sec = 0, .tv_nsec = FEED_POLL_NS};
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1 || fstat(fd, &info) == -1 || info.st_size < sizeof(Feed)) {
+        exit_game(ERROR_FEED_READ);
+    }
+    Feed* feed = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (feed == MAP_FAILED || __atomic_load_n(&feed->magic, __ATOMIC_ACQUIRE)
+            != FEED_MAGIC || feed->version != FEED_VERSION
+            || info.st_size < feed_size(feed->width, feed->height)) {
+        exit_game(ERROR_FEED_READ);
+    }
+
+    Feed* copy = malloc(info.st_size);
+    uint32_t shown = 0;
+    uint64_t seen = 0;
+    while (1) {
+        uint32_t seq = __atomic_load_n(&feed->seq, __ATOMIC_ACQUIRE);
+        if (seq % 2 || seq == shown) {
+            // Mid write, or nothing new
+            nanosleep(&poll, NULL);
+            continue;
+        }
+        memcpy(copy, feed, info.st_size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&feed->seq, __ATOMIC_RELAXED) != seq) {
+            continue;
+        }
+        shown = seq;
+
+        if (copy->numEvents - seen > FEED_EVENTS) {
+            printf("(%lu events missed)\n",
+                    (unsigned long)(copy->numEvents - seen - FEED_EVENTS));
+            seen = copy->numEvents - FEED_EVENTS;
+        }
+        for (; seen < copy->numEvents; seen++) {
+            FeedEvent* event = &copy->events[seen % FEED_EVENTS];
+            if (event->kind == FEED_REWIND) {
+                printf("Player %d rewinds\n", event->turn);
+            } else {
+                printf("Player %d plays %c%c in column %d row %d\n",
+                        event->turn, event->card.num, event->card.suit,
+                        event->col + 1, event->row + 1);
+            }
+        }
+        for (int i = 0; i < copy->height; i++) {
+            for (int j = 0; j < copy->width; j++) {
+                Card c = copy->board[i * copy->width + j];
+                printf("%c%c", (c.suit == '*') ? '.' : c.num,
+                        (c.suit == '*') ? '.' : c.suit);
+            }
+            printf("\n");
+        }
+        for (int i = 0; i < NUM_PLAYERS; i++) {
+            printf("Hand(%d):", i + 1);
+            for (int j = 0; j < copy->handLength[i]; j++) {
+                printf(" %c%c", copy->hands[i][j].num,
+                        copy->hands[i][j].suit);
+            }
+            printf("\n");
+        }
+        if (copy->finished) {
+            if (copy->exitCode) {
+                printf("Game ended early (exit %d)\n", copy->exitCode);
+            }
+            fflush(stdout);
+            break;
+        }
+        fflush(stdout);
+    }
+    free(copy);
+    munmap(feed, info.st_size);
+}
+
+/* Play every pair of strategies against each other on the same seeded
+ * decks, both ways round, then print Elo ratings.
+ *
+ * @param width - board width
+ * @param height - board height
+ * @param seeds - The number of decks to play on
+ * @param threads - The number of worker threads
+ * @param book - Opening book for the players (or NULL)
+ */
+void run_tournament(int width, int height, int seeds, int threads,
+        Book* book) {
+    Tournament tournament;
+    pthread_t* ids = malloc(sizeof(pthread_t) * threads);
+    Worker* workers = malloc(sizeof(Worker) * threads);
+    struct timespec start, end;
+    int pairs = numStrategies * (numStrategies - 1) / 2;
+    int n = 0;
+
+    tournament.width = width;
+    tournament.height = height;
+    tournament.book = book;
+    tournament.numMatches = seeds * pairs * NUM_PLAYERS;
+    tournament.matches = malloc(sizeof(Match) * tournament.numMatches);
+    for (int s = 0; s < seeds; s++) {
+        for (int i = 0; i < numStrategies; i++) {
+            for (int j = i + 1; j < numStrategies; j++) {
+                // Each pair plays each deck with colours swapped
+                tournament.matches[n++] = (Match){.seed = s + 1,
+                        .players = {i, j}};
+                tournament.matches[n++] = (Match){.seed = s + 1,
+                        .players = {j, i}};
+            }
+        }
+    }
+
+    tournament.numWorkers = threads;
+    tournament.queues = malloc(sizeof(WorkQueue) * threads);
+    for (int i = 0; i < threads; i++) {
+        WorkQueue* queue = &tournament.queues[i];
+        pthread_mutex_init(&queue->lock, NULL);
+        // Matches are dealt round robin, so each queue gets its share
+        queue->tasks = malloc(sizeof(int)
+                * ((tournament.numMatches + threads - 1) / threads));
+        queue->top = 0;
+        queue->bottom = 0;
+    }
+    for (int i = 0; i < tournament.numMatches; i++) {
+        WorkQueue* queue = &tournament.queues[i % threads];
+        queue->tasks[queue->bottom++] = i;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        workers[i] = (Worker){.tournament = &tournament, .id = i};
+        if (pthread_create(&ids[i], NULL, tournament_worker, &workers[i])) {
+            // Workers steal from every queue, so fewer threads still
+            // play every match
+            break;
+        }
+        started++;
+    }
+    if (!started) {
+        tournament_worker(&workers[0]);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    print_ratings(&tournament, (end.tv_sec - start.tv_sec)
+            + (end.tv_nsec - start.tv_nsec) / 1e9);
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_destroy(&tournament.queues[i].lock);
+        free(tournament.queues[i].tasks);
+    }
+    free(tournament.queues);
+    free(tournament.matches);
+    free(workers);
+    free(ids);
+}
+
+/* Tournament worker thread. Plays matches until none are left.
+ *
+ * @param arg - The Worker
+ */
+void* tournament_worker(void* arg) {
+    Worker* worker = arg;
+    int task;
+    while (next_task(worker->tournament, worker->id, &task)) {
+        play_match(worker->tournament, &worker->tournament->matches[task]);
+    }
+    return NULL;
+}
+
+/* Take a task from the worker's own queue, or steal one from another
+ * worker once its own is empty.
+ *
+ * @param tournament - The tournament being played
+ * @param id - The worker's queue
+ * @param task - Where to save the match index
+ * @return false if every queue is empty
+ */
+bool next_task(Tournament* tournament, int id, int* task) {
+    for (int i = 0; i < tournament->numWorkers; i++) {
+        int victim = (id + i) % tournament->numWorkers;
+        WorkQueue* queue = &tournament->queues[victim];
+        bool found = false;
+        pthread_mutex_lock(&queue->lock);
+        if (queue->top < queue->bottom) {
+            // Newest work from our own queue, oldest from others
+            *task = (i == 0) ? queue->tasks[--queue->bottom]
+                    : queue->tasks[queue->top++];
+            found = true;
+        }
+        pthread_mutex_unlock(&queue->lock);
+        if (found) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Play one tournament game to the end without printing.
+ *
+ * @param tournament - The tournament being played
+ * @param match - The match to play and record the scores in
+ */
+void play_match(Tournament* tournament, Match* match) {
+    Game game = {0};
+    Move move;
+    game.width = tournament->width;
+    game.height = tournament->height;
+    game.book = tournament->book;
+    for (int i = 0; i < NUM_PLAYERS; i++) {
+        game.playerType[i] = strategies[match->players[i]].type;
+    }
+    // Enough cards to fill the board, plus both opening hands
+    make_deck(&game.deck, match->seed,
+            game.width * game.height + HAND_SIZE * NUM_PLAYERS);
+
+    if (new_game(&game)) {
+        while (game.status && !board_full(&game) && deal_cards(&game)) {
+            if (find_strategy(game.playerType[game.turn - 1])
+                    ->choose(&game, &move)) {
+                make_move(&game, move.row, move.col, move.card);
+            }
+            game.turn = (game.turn == TURN_ONE) ? TURN_TWO : TURN_ONE;
+        }
+    }
+    score_board(&game, match->scores);
+    free_game(&game);
+    free(game.deck.cards);
+}
+
+/* Fill a deck with random cards from a seed.
+ *
+ * @param deck - The deck to fill
+ * @param seed - The same seed always gives the same deck
+ * @param length - The number of cards
+ */
+void make_deck(CardArray* deck, uint64_t seed, int length) {
+    uint64_t state = seed;
+    deck->length = length;
+    deck->cards = malloc(sizeof(Card) * length);
+    for (int i = 0; i < length; i++) {
+        uint64_t r = next_random(&state);
+        deck->cards[i] = (Card){.num = '1' + r % 9,
+                .suit = 'A' + (r / 9) % 26};
+    }
+}
+
+/* splitmix64, so decks do not depend on the C library or thread.
+ *
+ * @param state - The generator state, advanced by one step
+ */
+uint64_t next_random(uint64_t* state) {
+    return mix_bits(*state += 0x9E3779B97F4A7C15ULL);
+}
+
+/* The splitmix64 finaliser, also used to hash positions.
+ *
+ * @param z - The bits to mix
+ */
+uint64_t mix_bits(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Print each strategy's Elo rating and record, then the game rate.
+ * Ratings are updated in match order, so they only depend on the seeds.
+ *
+ * @param tournament - The finished tournament
+ * @param seconds - Time taken to play every match
+ */
+void print_ratings(Tournament* tournament, double seconds) {
+    double* elo = malloc(sizeof(double) * numStrategies);
+    int* record = calloc(numStrategies * 3, sizeof(int)); // W, L, D
+    for (int i = 0; i < numStrategies; i++) {
+        elo[i] = ELO_START;
+    }
+
+    for (int m = 0; m < tournament->numMatches; m++) {
+        Match* match = &tournament->matches[m];
+        int a = match->players[PLAYER_ONE];
+        int b = match->players[PLAYER_TWO];
+        int diff = match->scores[PLAYER_ONE] - match->scores[PLAYER_TWO];
+        double result = (diff > 0) ? 1.0 : (diff < 0) ? 0.0 : 0.5;
+        double expected = 1.0 / (1.0 + pow(10.0, (elo[b] - elo[a]) / 400.0));
+        elo[a] += ELO_K * (result - expected);
+        elo[b] -= ELO_K * (result - expected);
+        record[3 * a + ((diff > 0) ? 0 : (diff < 0) ? 1 : 2)]++;
+        record[3 * b + ((diff < 0) ? 0 : (diff > 0) ? 1 : 2)]++;
+    }
+
+    printf("%-10s %6s %5s %5s %5s\n", "Strategy", "Elo", "Win", "Loss",
+            "Draw");
+    for (int i = 0; i < numStrategies; i++) {
+        printf("%-10s %6.1f %5d %5d %5d\n", strategies[i].name, elo[i],
+                record[3 * i], record[3 * i + 1], record[3 * i + 2]);
+    }
+    printf("%d games in %.3fs (%.1f games/s)\n", tournament->numMatches,
+            seconds, (seconds > 0) ? tournament->numMatches / seconds : 0.0);
+    free(record);
+    free(elo);
+}
+
+/* Check if few enough cells or cards are left to solve exactly.
+ *
+ * @param game - information about the game state.
+ */
+bool endgame_near(Game* game) {
+    int empty = 0;
+    for (int i = 0; i < game->height; i++) {
+        for (int j = 0; j < game->width; j++) {
+            empty += (game->board[i][j].suit == '*');
+        }
+    }
+    return empty <= SOLVE_EMPTY_CELLS
+            || game->deck.length - game->cardsDrawn <= SOLVE_CARDS_LEFT;
+}
+
+/* The endgame AI strategy. Plays perfectly once the end is near enough
+ * to solve, and greedily before that.
+ *
+ * @param game - information about the game state.
+ * @param move - Where to save the move
+ */
+bool choose_endgame(Game* game, Move* move) {
+    int value;
+    long nodes;
+    if (endgame_near(game) && solve_root(game, move, &value, &nodes,
+            SOLVE_FULL_DEPTH, SOLVE_NODE_LIMIT, NULL)) {
+        return true;
+    }
+    return choose_greedy(game, move);
+}
+
+/* Find the move with the best final score difference for the player to
+ * move, searching every deal and reply to the end of the game, or to a
+ * depth. The deck order is known, so a full search is exact. The game is
+ * left unchanged.
+ *
+ * @param game - information about the game state, after the deal.
+ * @param best - Where to save the best move
+ * @param value - Where to save Player 1's final score less Player 2's
+ * @param nodes - Where to save the number of positions searched
+ * @param depth - Moves to search ahead, SOLVE_FULL_DEPTH for all of them
+ * @param limit - The most positions to search, usually SOLVE_NODE_LIMIT
+ * @param ponder - Pondering search to stop with (or NULL)
+ * @return false if there is no move or the search was too big or stopped
+ */
+bool solve_root(Game* game, Move* best, int* value, long* nodes, int depth,
+        long limit, Ponder* ponder) {
+    Solver solver = {.limit = limit, .ponder = ponder};
+    Game position;
+    int turn = game->turn - 1;
+    int alpha = -SOLVE_INFINITY;
+    int beta = SOLVE_INFINITY;
+    bool found = false;
+    copy_game(&position, game);
+    solver.table = calloc((size_t)1 << SOLVE_TABLE_BITS, sizeof(SolveEntry));
+    for (int i = 0; i < game->height; i++) {
+        for (int j = 0; j < game->width; j++) {
+            if (game->board[i][j].suit == '*') {
+                solver.empty++;
+            } else {
+                solver.boardHash ^= card_hash(i * game->width + j,
+                        game->board[i][j]);
+            }
+        }
+    }
+
+    for (int c = 0; c < position.hands[turn].length && !solver.aborted;
+            c++) {
+        if (duplicate_card(&position.hands[turn], c)) {
+            continue;
+        }
+        for (int i = 0; i < game->height; i++) {
+            for (int j = 0; j < game->width; j++) {
+                if (!legal_move(&position, i, j)) {
+                    continue;
+                }
+                Move move = (Move){.card = c, .row = i, .col = j};
+                Card card = position.hands[turn].cards[c];
+                int status = position.status;
+                solve_play(&solver, &position, move);
+                int result = solve_node(&solver, &position, alpha, beta,
+                        depth - 1);
+                solve_unplay(&solver, &position, move, card, status);
+                if (!found || (turn == PLAYER_ONE && result > *value)
+                        || (turn == PLAYER_TWO && result < *value)) {
+                    *value = result;
+                    *best = move;
+                    found = true;
+                }
+                // Only a strictly better move is worth finding now
+                if (turn == PLAYER_ONE) {
+                    alpha = *value;
+                } else {
+                    beta = *value;
+                }
+            }
+        }
+    }
+    *nodes = solver.nodes;
+    free(solver.table);
+    free_game(&position);
+    return found && !solver.aborted;
+}
+
+/* Solve a position at the start of a turn, before the deal, with
+ * alpha-beta pruning. Player 1 maximises and Player 2 minimises.
+ *
+ * @param solver - The search state
+ * @param game - The position, left unchanged
+ * @param alpha - The value Player 1 is already sure of
+ * @param beta - The value Player 2 is already sure of
+ * @param depth - Moves to search ahead, scoring the board at 0
+ * @return Player 1's final score less Player 2's with best play, if it
+ *      lies between alpha and beta, or else a bound beyond them
+ */
+int solve_node(Solver* solver, Game* game, int alpha, int beta, int depth) {
+    int scores[NUM_PLAYERS];
+    TurnRecord before;
+    if (++solver->nodes > solver->limit || (solver->nodes
+            % PONDER_CHECK_NODES == 0 && ponder_stopped(solver->ponder))) {
+        solver->aborted = true;
+        return 0;
+    }
+
+    record_deal(game, &before);
+    if (solver->empty == 0 || depth == 0 || !deal_cards(game)) {
+        // The game is over, as in game_loop, or the search is deep enough
+        undo_deal(game, &before);
+        score_board(game, scores);
+        return scores[PLAYER_ONE] - scores[PLAYER_TWO];
+    }
+
+    uint64_t key = solve_key(solver, game);
+    SolveEntry* entry = &solver->table[key
+            & (((uint64_t)1 << SOLVE_TABLE_BITS) - 1)];
+    if (entry->key == key && entry->depth >= depth
+            && (entry->bound == BOUND_EXACT
+            || (entry->bound == BOUND_LOWER && entry->value >= beta)
+            || (entry->bound == BOUND_UPPER && entry->value <= alpha))) {
+        undo_deal(game, &before);
+        return entry->value;
+    }
+
+    int turn = game->turn - 1;
+    int status = game->status;
+    int window[NUM_PLAYERS] = {alpha, beta};
+    int best = (turn == PLAYER_ONE) ? -SOLVE_INFINITY : SOLVE_INFINITY;
+    bool cut = false;
+    for (int c = 0; c < game->hands[turn].length && !cut; c++) {
+        if (duplicate_card(&game->hands[turn], c)) {
+            continue;
+        }
+        for (int i = 0; i < game->height && !cut; i++) {
+            for (int j = 0; j < game->width && !cut; j++) {
+                if (!legal_move(game, i, j)) {
+                    continue;
+                }
+                Move move = (Move){.card = c, .row = i, .col = j};
+                Card card = game->hands[turn].cards[c];
+                solve_play(solver, game, move);
+                int result = solve_node(solver, game, alpha, beta,
+                        depth - 1);
+                solve_unplay(solver, game, move, card, status);
+                if (turn == PLAYER_ONE) {
+                    best = (result > best) ? result : best;
+                    alpha = (best > alpha) ? best : alpha;
+                } else {
+                    best = (result < best) ? result : best;
+                    beta = (best < beta) ? best : beta;
+                }
+                cut = alpha >= beta || solver->aborted;
+            }
+        }
+    }
+    undo_deal(game, &before);
+    if (!solver->aborted) {
+        entry->key = key;
+        entry->value = best;
+        entry->depth = depth;
+        entry->bound = (best <= window[PLAYER_ONE]) ? BOUND_UPPER
+                : (best >= window[PLAYER_TWO]) ? BOUND_LOWER : BOUND_EXACT;
+    }
+    return best;
+}
+
+/* Make a move in the search and pass the turn.
+ *
+ * @param solver - The search state
+ * @param game - The position
+ * @param move - The move
+ */
+void solve_play(Solver* solver, Game* game, Move move) {
+    make_move(game, move.row, move.col, move.card);
+    solver->boardHash ^= card_hash(move.row * game->width + move.col,
+            game->board[move.row][move.col]);
+    solver->empty--;
+    game->turn = (game->turn == TURN_ONE) ? TURN_TWO : TURN_ONE;
+}
+
+/* Take back a move made by solve_play.
+ *
+ * @param solver - The search state
+ * @param game - The position
+ * @param move - The move
+ * @param card - The card played
+ * @param status - The status before the move
+ */
+void solve_unplay(Solver* solver, Game* game, Move move, Card card,
+        int status) {
+    game->turn = (game->turn == TURN_ONE) ? TURN_TWO : TURN_ONE;
+    solver->boardHash ^= card_hash(move.row * game->width + move.col, card);
+    solver->empty++;
+    unmake_move(game, move, card, status);
+}
+
+/* Hash a position after its deal. Hands are hashed as sums, so the
+ * order of cards in a hand does not matter.
+ *
+ * @param solver - The search state
+ * @param game - The position
+ */
+uint64_t solve_key(Solver* solver, Game* game) {
+    uint64_t key = solver->boardHash ^ mix_bits(((uint64_t)game->turn << 32)
+            | game->cardsDrawn);
+    key += hand_key(game);
+    return key ? key : 1; // 0 marks an unused entry
+}
+
+/* Hash both hands as sums, so the order of cards does not matter.
+ *
+ * @param game - The position
+ */
+uint64_t hand_key(Game* game) {
+    uint64_t key = 0;
+    for (int i = 0; i < NUM_PLAYERS; i++) {
+        for (int j = 0; j < game->hands[i].length; j++) {
+            key += card_hash(~(uint64_t)i, game->hands[i].cards[j]);
+        }
+    }
+    return key;
+}
+
+/* Hash a card in a place, either a board cell or a hand.
+ *
+ * @param where - The cell index, or a value for the hand
+ * @param card - The card
+ */
+uint64_t card_hash(uint64_t where, Card card) {
+    return mix_bits((where << 16) ^ (card.num << 8) ^ card.suit);
+}
+
+/* Print the best move and final score difference, if the position can
+ * be solved, along with the search rate. The search runs on one thread,
+ * so the rate is per core; make fuzz checks it against a target.
+ *
+ * @param game - information about the game state, after the deal.
+ */
+void analyse(Game* game) {
+    struct timespec start, end;
+    Move move;
+    int value;
+    long nodes;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool solved = solve_root(game, &move, &value, &nodes, SOLVE_FULL_DEPTH,
+            SOLVE_NODE_LIMIT, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec)
+            + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (!solved) {
+        printf("Unable to solve\n");
+    } else {
+        Card card = game->hands[game->turn - 1].cards[move.card];
+        printf("Player %d best plays %c%c in column %d row %d,"
+                " Player 1 - Player 2 = %d\n", game->turn, card.num,
+                card.suit, move.col + 1, move.row + 1, value);
+    }
+    printf("Searched %ld nodes in %.3fs (%.0f nodes/s on one core)\n", nodes,
+            seconds, (seconds > 0) ? nodes / seconds : 0.0);
+}
+
+/* Check if an AI should consider a cell. Every opening cell is the
+ * same on a torus, so only the centre is tried on an empty board.
+ *
+ * @param game - information about the game state
+ * @param row - board row
+ * @param col - board column
+ */
+bool legal_move(Game* game, int row, int col) {
+    if (game->status == NEW_GAME) {
+        return row == (game->height - 1) / 2 && col == (game->width - 1) / 2;
+    }
+    return adjacent_to(game, row, col);
+}
+
+/* Map an opening book into memory. AI players carry on without a book
+ * if it cannot be read.
+ *
+ * @param path - The book file
+ * @return The book, or NULL
+ */
+Book* book_open(char* path) {
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1 || fstat(fd, &info) == -1
+            || info.st_size < sizeof(BookHeader)) {
+        fprintf(stderr, "Unable to read book\n");
+        if (fd != -1) {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    void* map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    BookHeader* header = map;
+    if (map == MAP_FAILED || memcmp(header->magic, BOOK_MAGIC,
+            sizeof(header->magic)) || info.st_size != sizeof(BookHeader)
+            + header->count * sizeof(BookEntry)) {
+        fprintf(stderr, "Unable to read book\n");
+        if (map != MAP_FAILED) {
+            munmap(map, info.st_size);
+        }
+        return NULL;
+    }
+
+    Book* book = malloc(sizeof(Book));
+    book->map = map;
+    book->size = info.st_size;
+    book->entries = (BookEntry*)(header + 1);
+    book->count = header->count;
+    return book;
+}
+
+/* Look up the current position in the opening book.
+ *
+ * @param game - information about the game state, after the deal.
+ * @param move - Where to save the book move
+ * @return false if there is no book, no entry, or the entry cannot be
+ *      played here
+ */
+bool book_move(Game* game, Move* move) {
+    BookEntry key;
+    int turn = game->turn - 1;
+    if (!game->book) {
+        return false;
+    }
+
+    key.key = position_key(game);
+    BookEntry* entry = bsearch(&key, game->book->entries, game->book->count,
+            sizeof(BookEntry), compare_book);
+    if (!entry || entry->row >= game->height || entry->col >= game->width
+            || !legal_move(game, entry->row, entry->col)) {
+        return false;
+    }
+    for (int c = 0; c < game->hands[turn].length; c++) {
+        if (game->hands[turn].cards[c].num == entry->num
+                && game->hands[turn].cards[c].suit == entry->suit) {
+            *move = (Move){.card = c, .row = entry->row, .col = entry->col};
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Hash a position for the opening book, from the board size, board,
+ * hands and turn. The deck is left out so that the same opening from
+ * different decks shares an entry.
+ *
+ * @param game - The position
+ */
+uint64_t position_key(Game* game) {
+    uint64_t key = mix_bits(((uint64_t)game->width << 40)
+            | ((uint64_t)game->height << 20) | game->turn);
+    for (int i = 0; i < game->height; i++) {
+        for (int j = 0; j < game->width; j++) {
+            if (game->board[i][j].suit != '*') {
+                key ^= card_hash(i * game->width + j, game->board[i][j]);
+            }
+        }
+    }
+    return key + hand_key(game);
+}
+
+/* Order book entries by key.
+ *
+ * @param a - The first BookEntry
+ * @param b - The second BookEntry
+ */
+int compare_book(const void* a, const void* b) {
+    uint64_t x = ((const BookEntry*)a)->key;
+    uint64_t y = ((const BookEntry*)b)->key;
+    return (x > y) - (x < y);
+}
+
+/* Order entries being generated by key, then by when they were found.
+ *
+ * @param a - The first BuildEntry
+ * @param b - The second BuildEntry
+ */
+int compare_build(const void* a, const void* b) {
+    const BuildEntry* x = a;
+    const BuildEntry* y = b;
+    int order = compare_book(&x->entry, &y->entry);
+    return order ? order : (x->order > y->order) - (x->order < y->order);
+}
+
+/* Search the first plies of every game reachable from each deck and
+ * write the best moves to a book, merged with any book already there.
+ * The same position from different decks can search differently, so the
+ * earliest deck given wins.
+ *
+ * @param path - The book file
+ * @param width - board width
+ * @param height - board height
+ * @param plies - The number of opening moves to add entries for
+ * @param depth - Moves to search ahead from each position, solving it
+ *      exactly if it is at least the number of empty cells
+ * @param numDecks - The number of deck files
+ * @param decks - The deck files
+ */
+void build_book(char* path, int width, int height, int plies, int depth,
+        int numDecks, char** decks) {
+    BookBuilder builder = {.depth = depth};
+    BookHeader header;
+    Book* old = NULL;
+    FILE* f;
+    if ((f = fopen(path, "r"))) {
+        fclose(f);
+        if (!(old = book_open(path))) {
+            exit_game(ERROR_BAD_ARGS);
+        }
+    }
+
+    for (int d = 0; d < numDecks; d++) {
+        Game game = {0};
+        game.deckFile = decks[d];
+        game.width = width;
+        game.height = height;
+        parse_deck_file(&game);
+        // Deal Player 1's first turn, as game_loop does
+        if (!new_game(&game) || !deal_cards(&game)) {
+            exit_game(ERROR_SHORT_DECK);
+        }
+        book_explore(&builder, &game, plies);
+        free_game(&game);
+        free(game.deck.cards);
+    }
+
+    // Sort the new entries, keeping one per position, then merge in the
+    // old book. New entries win over old ones for the same position.
+    qsort(builder.entries, builder.count, sizeof(BuildEntry), compare_build);
+    uint64_t fresh = 0;
+    for (uint64_t i = 0; i < builder.count; i++) {
+        if (!fresh || builder.entries[fresh - 1].entry.key
+                != builder.entries[i].entry.key) {
+            builder.entries[fresh++] = builder.entries[i];
+        }
+    }
+    uint64_t oldCount = old ? old->count : 0;
+    BookEntry* merged = malloc(sizeof(BookEntry) * (fresh + oldCount + 1));
+    uint64_t count = 0, i = 0, j = 0;
+    while (i < fresh || j < oldCount) {
+        if (j == oldCount || (i < fresh
+                && builder.entries[i].entry.key <= old->entries[j].key)) {
+            if (j < oldCount
+                    && builder.entries[i].entry.key == old->entries[j].key) {
+                j++;
+            }
+            merged[count++] = builder.entries[i++].entry;
+        } else {
+            merged[count++] = old->entries[j++];
+        }
+    }
+    if (old) {
+        munmap(old->map, old->size);
+        free(old);
+    }
+
+    memcpy(header.magic, BOOK_MAGIC, sizeof(header.magic));
+    header.count = count;
+    if (!(f = fopen(path, "wb"))) {
+        exit_game(ERROR_BAD_ARGS);
+    }
+    fwrite(&header, sizeof(BookHeader), 1, f);
+    fwrite(merged, sizeof(BookEntry), count, f);
+    fclose(f);
+    printf("%lu book entries\n", (unsigned long)count);
+    free(builder.entries);
+    free(merged);
+}
+
+/* Add a book entry for this position, then for every position reachable
+ * within the remaining plies. Each position is searched a move deeper at
+ * a time up to the builder's depth, keeping the deepest search that
+ * finishes within SOLVE_NODE_LIMIT.
+ *
+ * @param builder - The entries so far
+ * @param game - The position, after the deal, left unchanged
+ * @param plies - How many plies to add entries for
+ */
+void book_explore(BookBuilder* builder, Game* game, int plies) {
+    int turn = game->turn - 1;
+    int status = game->status;
+    Move move, deepest;
+    int value, deepestValue;
+    long nodes;
+    int empty = 0;
+    bool found = false;
+    if (plies == 0) {
+        return;
+    }
+
+    for (int i = 0; i < game->height; i++) {
+        for (int j = 0; j < game->width; j++) {
+            empty += (game->board[i][j].suit == '*');
+        }
+    }
+    for (int depth = 1; depth <= builder->depth && depth <= empty
+            && solve_root(game, &deepest, &deepestValue, &nodes, depth,
+            SOLVE_NODE_LIMIT, NULL); depth++) {
+        move = deepest;
+        value = deepestValue;
+        found = true;
+    }
+    if (found) {
+        if (builder->count == builder->capacity) {
+            builder->capacity = (builder->capacity) ? builder->capacity * 2
+                    : HISTORY_START;
+            builder->entries = realloc(builder->entries,
+                    sizeof(BuildEntry) * builder->capacity);
+        }
+        Card card = game->hands[turn].cards[move.card];
+        builder->entries[builder->count] = (BuildEntry){.entry = {
+                .key = position_key(game), .num = card.num,
+                .suit = card.suit, .row = move.row, .col = move.col,
+                .value = value}, .order = builder->count};
+        builder->count++;
+    }
+
+    for (int c = 0; c < game->hands[turn].length; c++) {
+        if (duplicate_card(&game->hands[turn], c)) {
+            continue;
+        }
+        for (int i = 0; i < game->height; i++) {
+            for (int j = 0; j < game->width; j++) {
+                if (!legal_move(game, i, j)) {
+                    continue;
+                }
+                TurnRecord before;
+                Card card = game->hands[turn].cards[c];
+                move = (Move){.card = c, .row = i, .col = j};
+                make_move(game, i, j, c);
+                game->turn = (game->turn == TURN_ONE) ? TURN_TWO : TURN_ONE;
+                record_deal(game, &before);
+                if (deal_cards(game)) {
+                    book_explore(builder, game, plies - 1);
+                }
+                undo_deal(game, &before);
+                game->turn = (game->turn == TURN_ONE) ? TURN_TWO : TURN_ONE;
+                unmake_move(game, move, card, status);
+            }
+        }
+    }
 }
 
 /* Check if the provided position is adjacent to a Card
@@ -804,6 +3667,26 @@ void print_deck(Game* game) {
     printf("\n");
 }
 
+/* Set up a game from its deck, dimensions and player types and deal
+ * the opening hands.
+ *
+ * @param game - information about the game state
+ * @return false if the deck is too short to deal
+ */
+bool new_game(Game* game) {
+    game->cardsDrawn = 0;
+    game->status = NEW_GAME;
+    game->hands[PLAYER_ONE].length = 0;
+    game->hands[PLAYER_TWO].length = 0;
+    game->turn = PLAYER_ONE;
+    malloc_var(game);
+    if (!deal_cards(game)) {
+        return false;
+    }
+    game->turn = TURN_ONE;
+    return true;
+}
+
 /* Deal cards to each player.
  *
  * @param game - information about the game state
@@ -816,12 +3699,11 @@ bool deal_cards(Game* game) {
             if (j == HAND_SIZE - 1 && i + 1 != game->turn) {
                 break;
             }
-            game->hands[i].cards[j] = game->deck.cards[game->cardsDrawn++];
-            game->hands[i].length++;
-
-            if (game->deck.length < game->cardsDrawn) {
+            if (game->deck.length == game->cardsDrawn) {
                 return false;
             }
+            game->hands[i].cards[j] = game->deck.cards[game->cardsDrawn++];
+            game->hands[i].length++;
         }
     }
 
@@ -849,3 +3731,42 @@ void malloc_var(Game* game) {
     game->hands[PLAYER_TWO].cards = malloc(sizeof(Card) * HAND_SIZE);
 }
 
+/* Copy the game into a new board and hands, sharing the deck.
+ *
+ * @param dest - Where to make the copy
+ * @param src - The game to copy
+ */
+void copy_game(Game* dest, Game* src) {
+    *dest = *src;
+    dest->ponder = NULL;
+    dest->history = (History){0};
+    dest->feed = NULL;
+    dest->paths = NULL;
+    malloc_var(dest);
+    for (int i = 0; i < src->height; i++) {
+        memcpy(dest->board[i], src->board[i], sizeof(Card) * src->width);
+    }
+    for (int i = 0; i < NUM_PLAYERS; i++) {
+        memcpy(dest->hands[i].cards, src->hands[i].cards,
+                sizeof(Card) * HAND_SIZE);
+    }
+}
+
+/* Free the board and hands of a game copy.
+ *
+ * @param game - The copy to free
+ */
+void free_game(Game* game) {
+    for (int i = 0; i < game->height; i++) {
+        free(game->board[i]);
+    }
+    free(game->board);
+    free(game->hands[PLAYER_ONE].cards);
+    free(game->hands[PLAYER_TWO].cards);
+    if (game->paths) {
+        free(game->paths->best);
+        free(game->paths->next);
+        free(game->paths->valid);
+        free(game->paths);
+    }
+}
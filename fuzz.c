@@ -0,0 +1,830 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* Differential fuzzer for bark. Runs random decks, saves and human input
+ * through an optimised build and a reference build (-DBARK_REFERENCE)
+ * and checks that exit status, stdout and stderr match byte for byte,
+ * except that the reference build prints path lengths without cells, so
+ * printed paths are checked for shape instead. Saves are also loaded
+ * from an archive in the optimised build, to check the archive path
+ * against the plain file parser. Cases with only basic AI and human
+ * players and no new commands are also run against the original bark,
+ * built from bark_baseline.c, since the two builds share everything but
+ * scoring. Finally both builds play a few large games and the optimised
+ * build must be fast enough, and the endgame solver must meet its node
+ * rate target. An opening book is also generated and must be used for
+ * the first move.
+ */
+
+/* Exit status codes */
+#define FUZZ_OK 0
+#define FUZZ_USAGE 1
+#define FUZZ_MISMATCH 2
+#define FUZZ_SLOW 3
+#define FUZZ_BOOK 4
+
+/* Defaults */
+#define DEFAULT_CASES 300
+#define DEFAULT_SEED 1
+#define DEFAULT_SPEEDUP 2.0
+
+/* Limits */
+#define MAX_ARGS 8
+#define PATH_SIZE 256
+#define DIR_SIZE 64
+#define RUN_TIMEOUT 60
+#define BENCH_GAMES 2
+#define BENCH_SIZE 14
+#define BENCH_SUITS 4
+#define RATE_SAVES 5
+#define RATE_MIN_NODES 1000000
+#define RATE_STEPS 200000000 // Calibration steps, about a second
+#define RATE_STEPS_PER_NODE 10000 // The most a solver node may cost
+#define BOOK_SIZE 5
+#define BOOK_COUNT_OFFSET 8 // The count, after the magic
+#define BOOK_CARD_OFFSET 24 // The first entry's card, after its key
+#define OPENING_CARDS 11 // Both hands, then Player 1's sixth card
+
+/* The outcome of one run of bark.
+ *
+ * @param status - The raw wait status
+ * @param seconds - Wall time taken
+ */
+typedef struct {
+    int status;
+    double seconds;
+} Run;
+
+/* Everything shared between cases.
+ *
+ * @param optimised - Path to the optimised bark
+ * @param reference - Path to the reference bark
+ * @param baseline - Path to the original bark, built from bark_baseline.c
+ * @param dir - Scratch directory for generated files
+ * @param state - Random number generator state
+ * @param width - The current case's board width
+ * @param height - The current case's board height
+ */
+typedef struct {
+    char* optimised;
+    char* reference;
+    char* baseline;
+    char dir[DIR_SIZE];
+    uint64_t state;
+    int width;
+    int height;
+} Fuzzer;
+
+/* Setup functions */
+bool read_number(char* line, double* value);
+void make_path(Fuzzer* fuzzer, char* path, const char* name);
+
+/* Random functions */
+uint64_t next_random(Fuzzer* fuzzer);
+int random_range(Fuzzer* fuzzer, int low, int high);
+bool chance(Fuzzer* fuzzer, int percent);
+
+/* Generation functions */
+char random_player(Fuzzer* fuzzer, bool human);
+int write_deck(Fuzzer* fuzzer, char* path, int length, int suits,
+        bool mutate);
+void write_save(Fuzzer* fuzzer, char* path, char* deck, int width,
+        int height, int deckLength, bool mutate);
+void write_input(Fuzzer* fuzzer, char* path, int width, int height,
+        bool commands);
+
+/* Running functions */
+Run run_bark(char* bark, char** args, char* input, char* out, char* err);
+bool same_file(char* a, char* b);
+int path_prefix(char* line, int* player, char* suit, int* length);
+bool valid_path(Fuzzer* fuzzer, char* cells, int player, char suit,
+        int length);
+bool same_output(Fuzzer* fuzzer, char* opt, char* ref);
+bool compare(Fuzzer* fuzzer, int id, char* reference, char** optArgs,
+        char** refArgs, char* input, double* times);
+bool fuzz_case(Fuzzer* fuzzer, int id);
+bool baseline_case(Fuzzer* fuzzer, int id);
+bool benchmark(Fuzzer* fuzzer, double minSpeedup);
+double calibrate(Fuzzer* fuzzer);
+bool node_rate(Fuzzer* fuzzer);
+bool book_check(Fuzzer* fuzzer);
+
+int main(int argc, char** argv) {
+    Fuzzer fuzzer;
+    double cases = DEFAULT_CASES;
+    double seed = DEFAULT_SEED;
+    double minSpeedup = DEFAULT_SPEEDUP;
+    if (argc < 4 || argc > 7 || (argc > 4 && !read_number(argv[4], &cases))
+            || (argc > 5 && !read_number(argv[5], &seed))
+            || (argc > 6 && !read_number(argv[6], &minSpeedup))) {
+        fprintf(stderr, "Usage: bark_fuzz bark bark_ref bark_base [cases "
+                "[seed [speedup]]]\n");
+        return FUZZ_USAGE;
+    }
+
+    fuzzer.optimised = argv[1];
+    fuzzer.reference = argv[2];
+    fuzzer.baseline = argv[3];
+    fuzzer.state = (uint64_t)seed;
+    strcpy(fuzzer.dir, "/tmp/bark_fuzz.XXXXXX");
+    if (!mkdtemp(fuzzer.dir)) {
+        fprintf(stderr, "Unable to make scratch directory\n");
+        return FUZZ_USAGE;
+    }
+
+    for (int i = 0; i < (int)cases; i++) {
+        if (!fuzz_case(&fuzzer, i) || !baseline_case(&fuzzer, i)) {
+            fprintf(stderr, "Files kept in %s\n", fuzzer.dir);
+            return FUZZ_MISMATCH;
+        }
+    }
+    printf("%d cases matched\n", (int)cases);
+    if (!book_check(&fuzzer)) {
+        fprintf(stderr, "Files kept in %s\n", fuzzer.dir);
+        return FUZZ_BOOK;
+    }
+    if (!benchmark(&fuzzer, minSpeedup) || !node_rate(&fuzzer)) {
+        return FUZZ_SLOW;
+    }
+
+    char command[DIR_SIZE + 16];
+    snprintf(command, sizeof(command), "rm -rf %s", fuzzer.dir);
+    return (system(command) == 0) ? FUZZ_OK : FUZZ_USAGE;
+}
+
+/* Read a positive number from an argument.
+ *
+ * @param line - The argument
+ * @param value - Where to save the number
+ */
+bool read_number(char* line, double* value) {
+    char* end;
+    *value = strtod(line, &end);
+    return *line && !*end && *value > 0;
+}
+
+/* Build the path of a file in the scratch directory.
+ *
+ * @param fuzzer - The fuzzer
+ * @param path - Where to save the path, PATH_SIZE long
+ * @param name - The file name
+ */
+void make_path(Fuzzer* fuzzer, char* path, const char* name) {
+    snprintf(path, PATH_SIZE, "%s/%s", fuzzer->dir, name);
+}
+
+/* splitmix64, so cases only depend on the seed.
+ *
+ * @param fuzzer - The fuzzer
+ */
+uint64_t next_random(Fuzzer* fuzzer) {
+    uint64_t z = (fuzzer->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* A random integer from low to high inclusive.
+ *
+ * @param fuzzer - The fuzzer
+ * @param low - The smallest value
+ * @param high - The largest value
+ */
+int random_range(Fuzzer* fuzzer, int low, int high) {
+    return low + next_random(fuzzer) % (high - low + 1);
+}
+
+/* True with the given probability.
+ *
+ * @param fuzzer - The fuzzer
+ * @param percent - The chance out of 100
+ */
+bool chance(Fuzzer* fuzzer, int percent) {
+    return random_range(fuzzer, 1, 100) <= percent;
+}
+
+/* A random player type.
+ *
+ * @param fuzzer - The fuzzer
+ * @param human - Whether humans are allowed
+ */
+char random_player(Fuzzer* fuzzer, bool human) {
+    const char* types = "apeh";
+    return types[random_range(fuzzer, 0, human ? 3 : 2)];
+}
+
+/* Write a random deck file, sometimes with a mistake in it.
+ *
+ * @param fuzzer - The fuzzer
+ * @param path - The file to write
+ * @param length - The number of cards
+ * @param suits - The number of suits to use, fewer gives longer paths
+ * @param mutate - Whether a mistake may be made
+ * @return The number of cards written
+ */
+int write_deck(Fuzzer* fuzzer, char* path, int length, int suits,
+        bool mutate) {
+    FILE* f = fopen(path, "w");
+    int mistake = (mutate && chance(fuzzer, 20)) ? random_range(fuzzer, 0, 4)
+            : -1;
+    fprintf(f, "%d\n", (mistake == 0) ? length + 1 : (mistake == 1) ? -length
+            : length);
+    for (int i = 0; i < length; i++) {
+        char num = '1' + random_range(fuzzer, 0, 8);
+        char suit = 'A' + random_range(fuzzer, 0, suits - 1);
+        if (mistake == 2 && i == length / 2) {
+            fprintf(f, "%c%c\n", '0', suit);
+        } else if (mistake == 3 && i == length / 2) {
+            fprintf(f, "%c%c%c\n", num, suit, suit);
+        } else {
+            fprintf(f, "%c%c\n", num, suit);
+        }
+    }
+    if (mistake == 4) {
+        fprintf(f, "1A\n");
+    }
+    fclose(f);
+    return length;
+}
+
+/* Write a random save file, sometimes with a mistake in it.
+ *
+ * @param fuzzer - The fuzzer
+ * @param path - The file to write
+ * @param deck - The deck file it refers to
+ * @param width - board width
+ * @param height - board height
+ * @param deckLength - The number of cards in the deck
+ * @param mutate - Whether a mistake may be made
+ */
+void write_save(Fuzzer* fuzzer, char* path, char* deck, int width,
+        int height, int deckLength, bool mutate) {
+    FILE* f = fopen(path, "w");
+    int mistake = (mutate && chance(fuzzer, 25)) ? random_range(fuzzer, 0, 5)
+            : -1;
+    int turn = random_range(fuzzer, 1, 2);
+    int drawn = random_range(fuzzer, 11, deckLength > 11 ? deckLength : 11);
+    int fill = random_range(fuzzer, 0, 70);
+
+    fprintf(f, "%d %d %d %d\n", width, height,
+            (mistake == 0) ? random_range(fuzzer, 0, 10) : drawn,
+            (mistake == 1) ? 3 : turn);
+    fprintf(f, "%s\n", deck);
+    for (int p = 1; p <= 2; p++) {
+        for (int i = 0; i < ((p == turn) ? 6 : 5); i++) {
+            fprintf(f, "%c%c", '1' + random_range(fuzzer, 0, 8),
+                    'A' + random_range(fuzzer, 0, 5));
+        }
+        fprintf(f, "\n");
+    }
+    for (int i = 0; i < height - (mistake == 2); i++) {
+        for (int j = 0; j < width + (mistake == 3 && i == 0); j++) {
+            if (mistake == 4 && i == 0 && j == 0) {
+                fprintf(f, "1a");
+            } else if (mistake == 5 || chance(fuzzer, fill)) {
+                // A full board is also a mistake
+                fprintf(f, "%c%c", '1' + random_range(fuzzer, 0, 8),
+                        'A' + random_range(fuzzer, 0, 5));
+            } else {
+                fprintf(f, "**");
+            }
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
+
+/* Write random human input, mostly moves, some of them invalid.
+ *
+ * @param fuzzer - The fuzzer
+ * @param path - The file to write
+ * @param width - board width
+ * @param height - board height
+ * @param commands - Whether to use commands the original bark lacks
+ */
+void write_input(Fuzzer* fuzzer, char* path, int width, int height,
+        bool commands) {
+    const char* lines[] = {"", "1 1", "x y z", "1  1 1", "UNDO", "REDO",
+            "PATHS"};
+    FILE* f = fopen(path, "w");
+    int count = random_range(fuzzer, 0, 4 * width * height);
+    for (int i = 0; i < count; i++) {
+        if (chance(fuzzer, 10)) {
+            fprintf(f, "%s\n", lines[random_range(fuzzer, 0,
+                    commands ? 6 : 3)]);
+        } else {
+            fprintf(f, "%d %d %d\n", random_range(fuzzer, 0, 7),
+                    random_range(fuzzer, 0, width + 1),
+                    random_range(fuzzer, 0, height + 1));
+        }
+    }
+    fclose(f);
+}
+
+/* Run bark to completion with its output saved to files.
+ *
+ * @param bark - The bark to run
+ * @param args - The arguments, without the program name, NULL terminated
+ * @param input - The file to use as stdin
+ * @param out - The file to save stdout to
+ * @param err - The file to save stderr to
+ */
+Run run_bark(char* bark, char** args, char* input, char* out, char* err) {
+    char* argv[MAX_ARGS + 2] = {bark};
+    struct timespec start, end;
+    Run run;
+    for (int i = 0; args[i]; i++) {
+        argv[i + 1] = args[i];
+    }
+
+    fflush(stdout);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int in = open(input, O_RDONLY);
+        int o = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int e = open(err, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(in, STDIN_FILENO);
+        dup2(o, STDOUT_FILENO);
+        dup2(e, STDERR_FILENO);
+        alarm(RUN_TIMEOUT);
+        execv(bark, argv);
+        _exit(127);
+    }
+    waitpid(pid, &run.status, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    run.seconds = (end.tv_sec - start.tv_sec)
+            + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return run;
+}
+
+/* Check if two files have the same bytes.
+ *
+ * @param a - The first file
+ * @param b - The second file
+ */
+bool same_file(char* a, char* b) {
+    FILE* fa = fopen(a, "rb");
+    FILE* fb = fopen(b, "rb");
+    int ca, cb;
+    bool same = fa && fb;
+    while (same) {
+        ca = fgetc(fa);
+        cb = fgetc(fb);
+        same = (ca == cb);
+        if (ca == EOF || cb == EOF) {
+            break;
+        }
+    }
+    if (fa) {
+        fclose(fa);
+    }
+    if (fb) {
+        fclose(fb);
+    }
+    return same;
+}
+
+/* Find where a printed path's cells start, after "Player 1=3:" or
+ * "Suit A=3:", which may follow prompts on the same line.
+ *
+ * @param line - The line
+ * @param player - Where to save the player, 0 for a suit
+ * @param suit - Where to save the suit, 0 for a player
+ * @param length - Where to save the path length
+ * @return The length of the line up to the cells, 0 if it has no path
+ */
+int path_prefix(char* line, int* player, char* suit, int* length) {
+    char* start = strstr(line, "Player ");
+    int end = 0;
+    *player = 0;
+    *suit = 0;
+    if (start && sscanf(start, "Player %d=%d:%n", player, length, &end) == 2
+            && end) {
+        return start - line + end;
+    }
+    start = strstr(line, "Suit ");
+    end = 0;
+    *player = 0;
+    if (start && sscanf(start, "Suit %c=%d:%n", suit, length, &end) == 2
+            && end) {
+        return start - line + end;
+    }
+    return 0;
+}
+
+/* Check the cells of a printed path: as many cards as its length,
+ * numbers increasing, each cell next to the last on the torus, and
+ * starting and ending on the suit, or on one of the player's suits.
+ *
+ * @param fuzzer - The fuzzer
+ * @param cells - The text after the prefix
+ * @param player - The player, 0 for a suit
+ * @param suit - The suit, 0 for a player
+ * @param length - The path length the reference build found
+ */
+bool valid_path(Fuzzer* fuzzer, char* cells, int player, char suit,
+        int length) {
+    char num, cardSuit, first = 0, last = 0, lastNum = 0;
+    int col, row, lastCol = 0, lastRow = 0, used, count = 0;
+    while (sscanf(cells, " %c%c(%d,%d)%n", &num, &cardSuit, &col, &row,
+            &used) == 4) {
+        int dc = (col - lastCol + fuzzer->width) % fuzzer->width;
+        int dr = (row - lastRow + fuzzer->height) % fuzzer->height;
+        if (col < 1 || col > fuzzer->width || row < 1 || row > fuzzer->height
+                || (count && (num <= lastNum || !((dr == 0 && (dc == 1
+                || dc == fuzzer->width - 1)) || (dc == 0 && (dr == 1
+                || dr == fuzzer->height - 1)))))) {
+            return false;
+        }
+        first = count ? first : cardSuit;
+        last = cardSuit;
+        lastNum = num;
+        lastCol = col;
+        lastRow = row;
+        count++;
+        cells += used;
+    }
+    if (strcmp(cells, "\n") || count != length) {
+        return false;
+    }
+    return !count || (first == last && (suit ? first == suit
+            : (first % 2 != 0) == (player == 1)));
+}
+
+/* Check if the optimised build's stdout matches the reference build's,
+ * checking the shape of paths the reference build does not print.
+ *
+ * @param fuzzer - The fuzzer
+ * @param opt - The optimised build's stdout
+ * @param ref - The reference build's stdout
+ */
+bool same_output(Fuzzer* fuzzer, char* opt, char* ref) {
+    FILE* fo = fopen(opt, "rb");
+    FILE* fr = fopen(ref, "rb");
+    char* a = NULL;
+    char* b = NULL;
+    size_t sizeA = 0, sizeB = 0;
+    bool same = fo && fr;
+    while (same) {
+        ssize_t lengthA = getline(&a, &sizeA, fo);
+        ssize_t lengthB = getline(&b, &sizeB, fr);
+        if (lengthA == -1 || lengthB == -1) {
+            same = (lengthA == lengthB);
+            break;
+        }
+        int player, length;
+        char suit;
+        int prefix = path_prefix(a, &player, &suit, &length);
+        if (prefix && !strncmp(a, b, prefix) && !strcmp(b + prefix, "\n")) {
+            same = valid_path(fuzzer, a + prefix, player, suit, length);
+        } else {
+            same = (lengthA == lengthB && !memcmp(a, b, lengthA));
+        }
+    }
+    free(a);
+    free(b);
+    if (fo) {
+        fclose(fo);
+    }
+    if (fr) {
+        fclose(fr);
+    }
+    return same;
+}
+
+/* Run the optimised build and another and check they agree, printing
+ * the case if not.
+ *
+ * @param fuzzer - The fuzzer
+ * @param id - The case number
+ * @param reference - The build to check against
+ * @param optArgs - Arguments for the optimised build
+ * @param refArgs - Arguments for the reference build
+ * @param input - The file to use as stdin
+ * @param times - Where to add the time taken by each build, or NULL
+ */
+bool compare(Fuzzer* fuzzer, int id, char* reference, char** optArgs,
+        char** refArgs, char* input, double* times) {
+    char outs[4][PATH_SIZE];
+    make_path(fuzzer, outs[0], "opt.out");
+    make_path(fuzzer, outs[1], "opt.err");
+    make_path(fuzzer, outs[2], "ref.out");
+    make_path(fuzzer, outs[3], "ref.err");
+    Run opt = run_bark(fuzzer->optimised, optArgs, input, outs[0], outs[1]);
+    Run ref = run_bark(reference, refArgs, input, outs[2], outs[3]);
+    if (times) {
+        times[0] += opt.seconds;
+        times[1] += ref.seconds;
+    }
+
+    // A hang in both builds is still a failure
+    const char* problem = (!WIFEXITED(opt.status) || !WIFEXITED(ref.status))
+            ? "signal" : (opt.status != ref.status) ? "exit status"
+            : !same_output(fuzzer, outs[0], outs[2]) ? "stdout"
+            : !same_file(outs[1], outs[3]) ? "stderr" : NULL;
+    if (!problem) {
+        return true;
+    }
+    fprintf(stderr, "Case %d: %s differs (status %d vs %d)\n", id, problem,
+            opt.status, ref.status);
+    fprintf(stderr, "  optimised:");
+    for (int i = 0; optArgs[i]; i++) {
+        fprintf(stderr, " %s", optArgs[i]);
+    }
+    fprintf(stderr, "\n  %s:", reference);
+    for (int i = 0; refArgs[i]; i++) {
+        fprintf(stderr, " %s", refArgs[i]);
+    }
+    fprintf(stderr, "\n  input: %s\n", input);
+    return false;
+}
+
+/* Generate one case and run it every way that applies.
+ *
+ * @param fuzzer - The fuzzer
+ * @param id - The case number
+ */
+bool fuzz_case(Fuzzer* fuzzer, int id) {
+    char deck[PATH_SIZE], save[PATH_SIZE], input[PATH_SIZE];
+    char archive[PATH_SIZE], stored[PATH_SIZE + 16];
+    char width[8], height[8], p1[2] = {0}, p2[2] = {0};
+    int w = random_range(fuzzer, 3, 9);
+    int h = random_range(fuzzer, 3, 9);
+    make_path(fuzzer, deck, "deck");
+    make_path(fuzzer, save, "save");
+    make_path(fuzzer, input, "input");
+    make_path(fuzzer, archive, "saves.bar");
+    fuzzer->width = w;
+    fuzzer->height = h;
+    snprintf(width, sizeof(width), "%d", w);
+    snprintf(height, sizeof(height), "%d", h);
+    p1[0] = random_player(fuzzer, true);
+    p2[0] = random_player(fuzzer, true);
+    if ((p1[0] == 'h' && p2[0] == 'p') || (p1[0] == 'p' && p2[0] == 'h')) {
+        // Pondering searches deeper the longer input takes to arrive, so
+        // its moves against a human depend on timing
+        p1[0] = (p1[0] == 'p') ? 'e' : p1[0];
+        p2[0] = (p2[0] == 'p') ? 'e' : p2[0];
+    }
+
+    int length = write_deck(fuzzer, deck, random_range(fuzzer, 8,
+            w * h + 20), random_range(fuzzer, 1, 26), true);
+    write_save(fuzzer, save, deck, w, h, length, true);
+    write_input(fuzzer, input, w, h, true);
+
+    // A new game from the deck
+    char* newGame[] = {deck, width, height, p1, p2, NULL};
+    if (!compare(fuzzer, id, fuzzer->reference, newGame, newGame, input,
+            NULL)) {
+        return false;
+    }
+
+    // The save, from a file and from an archive
+    char* fromFile[] = {save, p1, p2, NULL};
+    if (!compare(fuzzer, id, fuzzer->reference, fromFile, fromFile, input,
+            NULL)) {
+        return false;
+    }
+    char key[16];
+    snprintf(key, sizeof(key), "g%d/%d", id, random_range(fuzzer, 0, 99));
+    char* pack[] = {"--archive", archive, key, save, NULL};
+    char packOut[PATH_SIZE];
+    make_path(fuzzer, packOut, "pack.out");
+    Run packed = run_bark(fuzzer->optimised, pack, input, packOut, packOut);
+    snprintf(stored, sizeof(stored), "%s:%s", archive, key);
+    char* fromArchive[] = {stored, p1, p2, NULL};
+    if (WIFEXITED(packed.status) && WEXITSTATUS(packed.status) == 0
+            && !compare(fuzzer, id, fuzzer->reference, fromArchive, fromFile,
+            input, NULL)) {
+        return false;
+    }
+
+    // Path queries on the save, checked against the reference scorer
+    char* paths[] = {"--paths", save, NULL};
+    return compare(fuzzer, id, fuzzer->reference, paths, paths, input, NULL);
+}
+
+/* Generate a case the original bark can also run, with only basic AI
+ * and human players and no new commands, and check today's bark still
+ * behaves the same. This covers the deck, save and input parsing and
+ * dealing that the reference build shares with the optimised one.
+ *
+ * @param fuzzer - The fuzzer
+ * @param id - The case number
+ */
+bool baseline_case(Fuzzer* fuzzer, int id) {
+    char deck[PATH_SIZE], save[PATH_SIZE], input[PATH_SIZE];
+    char width[8], height[8], p1[2] = {0}, p2[2] = {0};
+    int w = random_range(fuzzer, 3, 9);
+    int h = random_range(fuzzer, 3, 9);
+    make_path(fuzzer, deck, "base.deck");
+    make_path(fuzzer, save, "base.save");
+    make_path(fuzzer, input, "base.input");
+    snprintf(width, sizeof(width), "%d", w);
+    snprintf(height, sizeof(height), "%d", h);
+    p1[0] = chance(fuzzer, 50) ? 'a' : 'h';
+    p2[0] = chance(fuzzer, 50) ? 'a' : 'h';
+    fuzzer->width = w;
+    fuzzer->height = h;
+
+    int length = write_deck(fuzzer, deck, random_range(fuzzer, 8,
+            w * h + 20), random_range(fuzzer, 1, 26), true);
+    write_save(fuzzer, save, deck, w, h, length, true);
+    write_input(fuzzer, input, w, h, false);
+
+    char* newGame[] = {deck, width, height, p1, p2, NULL};
+    char* fromFile[] = {save, p1, p2, NULL};
+    return compare(fuzzer, id, fuzzer->baseline, newGame, newGame, input,
+            NULL) && compare(fuzzer, id, fuzzer->baseline, fromFile,
+            fromFile, input, NULL);
+}
+
+/* Time both builds on large AI games, which are dominated by scoring.
+ *
+ * @param fuzzer - The fuzzer
+ * @param minSpeedup - How many times faster the optimised build must be
+ * @return false if the builds disagree or the speedup is too small
+ */
+bool benchmark(Fuzzer* fuzzer, double minSpeedup) {
+    char deck[PATH_SIZE], input[PATH_SIZE], size[8];
+    double times[2] = {0, 0};
+    make_path(fuzzer, deck, "bench.deck");
+    make_path(fuzzer, input, "bench.input");
+    snprintf(size, sizeof(size), "%d", BENCH_SIZE);
+    fclose(fopen(input, "w"));
+    fuzzer->width = BENCH_SIZE;
+    fuzzer->height = BENCH_SIZE;
+
+    for (int i = 0; i < BENCH_GAMES; i++) {
+        char* args[] = {deck, size, size, "p", "p", NULL};
+        write_deck(fuzzer, deck, BENCH_SIZE * BENCH_SIZE + 12, BENCH_SUITS,
+                false);
+        if (!compare(fuzzer, -1 - i, fuzzer->reference, args, args, input,
+                times)) {
+            return false;
+        }
+    }
+
+    double speedup = (times[0] > 0) ? times[1] / times[0] : 0;
+    printf("Benchmark: optimised %.3fs, reference %.3fs, %.2fx faster "
+            "(need %.2fx)\n", times[0], times[1], speedup, minSpeedup);
+    return speedup >= minSpeedup;
+}
+
+/* Time a fixed number of random number steps, as a measure of this
+ * machine's speed that does not depend on bark.
+ *
+ * @param fuzzer - The fuzzer, whose state is left unchanged
+ * @return Steps per second
+ */
+double calibrate(Fuzzer* fuzzer) {
+    Fuzzer copy = *fuzzer;
+    struct timespec start, end;
+    volatile uint64_t sink = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < RATE_STEPS; i++) {
+        sink ^= next_random(&copy);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec)
+            + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return (seconds > 0) ? RATE_STEPS / seconds : 0;
+}
+
+/* Solve large saves with the optimised build, which mostly stop at the
+ * node limit. The solver's rate on one core must be at least one node
+ * per RATE_STEPS_PER_NODE calibration steps, timed either side of it so
+ * the target follows the machine and its load.
+ *
+ * @param fuzzer - The fuzzer
+ * @return false if the rate is below target or too few nodes were searched
+ */
+bool node_rate(Fuzzer* fuzzer) {
+    char deck[PATH_SIZE], save[PATH_SIZE], input[PATH_SIZE];
+    char out[PATH_SIZE], err[PATH_SIZE];
+    long nodes, total = 0;
+    double seconds, rate, time = 0;
+    make_path(fuzzer, deck, "rate.deck");
+    make_path(fuzzer, save, "rate.save");
+    make_path(fuzzer, input, "rate.input");
+    make_path(fuzzer, out, "rate.out");
+    make_path(fuzzer, err, "rate.err");
+    fclose(fopen(input, "w"));
+
+    double steps = calibrate(fuzzer);
+    int length = write_deck(fuzzer, deck, BENCH_SIZE * BENCH_SIZE + 12,
+            BENCH_SUITS, false);
+    for (int i = 0; i < RATE_SAVES && total < RATE_MIN_NODES; i++) {
+        char* args[] = {"--solve", save, NULL};
+        write_save(fuzzer, save, deck, BENCH_SIZE, BENCH_SIZE, length, false);
+        run_bark(fuzzer->optimised, args, input, out, err);
+        FILE* f = fopen(out, "r");
+        char line[PATH_SIZE];
+        while (f && fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "Searched %ld nodes in %lfs (%lf nodes/s",
+                    &nodes, &seconds, &rate) == 3) {
+                total += nodes;
+                time += seconds;
+            }
+        }
+        if (f) {
+            fclose(f);
+        }
+    }
+    steps = (steps + calibrate(fuzzer)) / 2;
+
+    double target = steps / RATE_STEPS_PER_NODE;
+    rate = (time > 0) ? total / time : 0;
+    printf("Solver: %ld nodes in %.3fs, %.0f nodes/s (need %.0f, from "
+            "%.0f steps/s)\n", total, time, rate, target, steps);
+    return total >= RATE_MIN_NODES && rate >= target;
+}
+
+/* Generate a one ply book, then make its move each card Player 1 starts
+ * with in turn. The AI must play whichever card the book gives, so the
+ * book is hit on the first move.
+ *
+ * @param fuzzer - The fuzzer
+ * @return false if the book is not made or not used
+ */
+bool book_check(Fuzzer* fuzzer) {
+    char deck[PATH_SIZE], book[PATH_SIZE], input[PATH_SIZE];
+    char out[PATH_SIZE], err[PATH_SIZE], size[8], expected[64];
+    char cards[OPENING_CARDS][3];
+    uint64_t count = 0;
+    int length;
+    make_path(fuzzer, deck, "book.deck");
+    make_path(fuzzer, book, "book.bk");
+    make_path(fuzzer, input, "book.input");
+    make_path(fuzzer, out, "book.out");
+    make_path(fuzzer, err, "book.err");
+    snprintf(size, sizeof(size), "%d", BOOK_SIZE);
+    fclose(fopen(input, "w"));
+    remove(book);
+
+    write_deck(fuzzer, deck, BOOK_SIZE * BOOK_SIZE + 12, BENCH_SUITS, false);
+    FILE* f = fopen(deck, "r");
+    bool read = f && fscanf(f, "%d", &length) == 1;
+    for (int i = 0; read && i < OPENING_CARDS; i++) {
+        read = fscanf(f, "%2s", cards[i]) == 1;
+    }
+    if (f) {
+        fclose(f);
+    }
+    char* generate[] = {"--book", book, size, size, "1", "3", deck, NULL};
+    Run made = run_bark(fuzzer->optimised, generate, input, out, err);
+    if (read && (f = fopen(book, "rb"))) {
+        fseek(f, BOOK_COUNT_OFFSET, SEEK_SET);
+        read = fread(&count, sizeof(count), 1, f) == 1;
+        fclose(f);
+    }
+    if (!read || !WIFEXITED(made.status) || WEXITSTATUS(made.status)
+            || count != 1) {
+        fprintf(stderr, "Book: unable to generate a one entry book\n");
+        return false;
+    }
+
+    setenv("BARK_BOOK", book, 1);
+    for (int i = 0; i < OPENING_CARDS; i++) {
+        if (i >= 5 && i < 10) {
+            // Player 2's hand
+            continue;
+        }
+        char* args[] = {deck, size, size, "p", "p", NULL};
+        f = fopen(book, "r+b");
+        fseek(f, BOOK_CARD_OFFSET, SEEK_SET);
+        fwrite(cards[i], 1, 2, f);
+        fclose(f);
+        run_bark(fuzzer->optimised, args, input, out, err);
+
+        char line[PATH_SIZE] = "";
+        f = fopen(out, "r");
+        while (f && fgets(line, sizeof(line), f)
+                && strncmp(line, "Player 1 plays", 14)) {
+        }
+        if (f) {
+            fclose(f);
+        }
+        snprintf(expected, sizeof(expected), "Player 1 plays %s in column "
+                "%d row %d\n", cards[i], (BOOK_SIZE + 1) / 2,
+                (BOOK_SIZE + 1) / 2);
+        if (strcmp(line, expected)) {
+            fprintf(stderr, "Book: expected %s  got %s", expected, line);
+            unsetenv("BARK_BOOK");
+            return false;
+        }
+    }
+    unsetenv("BARK_BOOK");
+    printf("Book: first move served from the book\n");
+    return true;
+}